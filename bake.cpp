@@ -0,0 +1,1073 @@
+//
+//  bake.cpp
+//  Marching Cube Terrain
+//
+//  Created by Dmitri Wamback on 2026-10-16.
+//
+//  Headless world baker: generates a width x depth region of chunks for a
+//  seed, streams the meshes to disk and reports generation throughput.
+//
+//  bake --seed 1234 --region 20 20 --origin -10 -10 --out world.mctb
+//
+
+#include <iostream>
+#include <memory>
+#include <cstring>
+#include "src/headless.h"
+#include "src/util/allocationCounter.h"
+
+static void printUsage() {
+    std::cout << "usage: bake [--seed S] [--region W D] [--origin X Z] [--out path] [--threads N]\n"
+                 "            [--noise scalar|sse4.1|avx2] [--mesh flat|indexed] [--vertex full|packed]\n"
+                 "            [--bricks on|off] [--density full|discard|half|compressed] [--lod 0-3]\n"
+                 "            [--order rows|spiral] [--edit-bench N] [--cull-bench N]\n"
+                 "            [--signs on|off] [--mesh-bench N] [--octaves bounded|full] [--octave-check]\n"
+                 "            [--cache dir] [--cache-prune] [--check-noise] [--scaling] [--latency]\n"
+                 "            [--config file] [--param key=value] [--golden-write file] [--golden-check file]\n"
+                 "            [--graph file] [--graph-dump] [--trace file] [--alloc-check] [--parallel-mesh on|off]\n"
+                 "            [--occlusion-bench N] [--density-check]\n";
+}
+
+struct BakeStats {
+    uint64_t chunks = 0, triangles = 0, vertices = 0;
+    uint64_t memoryBytes = 0;
+    uint64_t bricksSkipped = 0, bricksTotal = 0, cubesVisited = 0, cubesSkipped = 0;
+    uint64_t voxelsSampled = 0, octavesSampled = 0, rowsRefined = 0;
+    uint64_t sectionsStored = 0, sectionsSampled = 0;
+    uint64_t allocations = 0, meshesCounted = 0, countMismatches = 0;
+    double generationSeconds = 0.0, densitySeconds = 0.0, meshSeconds = 0.0;
+};
+
+// Rows walks the region x-major; Spiral goes outwards from its centre, the way
+// ChunkManager streams chunks in around the camera.
+enum class BakeOrder {
+    Rows,
+    Spiral
+};
+
+// Generates the region in batches of a few chunks per thread. Each batch is
+// written out (if there is a writer) before the next one starts, which keeps
+// memory bounded by the batch size rather than the region size. The batch's
+// terrains are reused from one batch to the next (and across calls when the
+// caller passes its own); heap allocations are counted while chunks generate.
+static BakeStats bakeRegion(int originX, int originZ, int width, int depth, ChunkWriter* writer, int lod = 0,
+                            BakeOrder order = BakeOrder::Rows, std::vector<Terrain>* reuse = nullptr) {
+    BakeStats stats;
+    
+    std::vector<Terrain> ownBatch;
+    std::vector<Terrain>& batch = reuse ? *reuse : ownBatch;
+    if (batch.empty()) batch = std::vector<Terrain>(jobSystem.ThreadCount() * 2);
+    size_t batchSize = batch.size();
+    std::vector<glm::ivec2> coordinates;
+    
+    for (int x = originX; x < originX + width; x++) {
+        for (int z = originZ; z < originZ + depth; z++) {
+            coordinates.push_back(glm::ivec2(x, z));
+        }
+    }
+    
+    if (order == BakeOrder::Spiral) {
+        float centerX = originX + (width - 1) * 0.5f;
+        float centerZ = originZ + (depth - 1) * 0.5f;
+        std::stable_sort(coordinates.begin(), coordinates.end(), [=](glm::ivec2 a, glm::ivec2 b) {
+            float da = (a.x - centerX) * (a.x - centerX) + (a.y - centerZ) * (a.y - centerZ);
+            float db = (b.x - centerX) * (b.x - centerX) + (b.y - centerZ) * (b.y - centerZ);
+            return da < db;
+        });
+    }
+    
+    for (size_t first = 0; first < coordinates.size(); first += batchSize) {
+        size_t count = std::min(batchSize, coordinates.size() - first);
+        
+        auto batchStart = std::chrono::steady_clock::now();
+        uint64_t allocations = heapAllocations;
+        JobGroup chunks;
+        for (size_t i = 0; i < count; i++) {
+            glm::ivec2 chunk = coordinates[first + i];
+            Terrain* terrain = &batch[i];
+            jobSystem.Submit(chunks, [=]() {
+                loadOrGenerateChunk(*terrain, chunk.x, chunk.y, lod);
+            });
+        }
+        jobSystem.Wait(chunks);
+        stats.allocations += heapAllocations - allocations;
+        stats.generationSeconds += std::chrono::duration<double>(std::chrono::steady_clock::now() - batchStart).count();
+        
+        for (size_t i = 0; i < count; i++) {
+            if (writer) writer->Write(coordinates[first + i].x, coordinates[first + i].y, batch[i]);
+            stats.chunks++;
+            stats.triangles += batch[i].TriangleCount();
+            stats.vertices += batch[i].VertexCount();
+            stats.memoryBytes += batch[i].MemoryBytes();
+            stats.bricksSkipped += batch[i].stats.bricksSkipped;
+            stats.bricksTotal += batch[i].stats.bricksTotal;
+            stats.cubesVisited += batch[i].stats.cubesVisited;
+            stats.cubesSkipped += batch[i].stats.cubesSkipped;
+            stats.voxelsSampled += batch[i].stats.voxelsSampled;
+            stats.octavesSampled += batch[i].stats.octavesSampled;
+            stats.rowsRefined += batch[i].stats.rowsRefined;
+            if (batch[i].stats.voxelsSampled) {
+                stats.sectionsStored += batch[i].stats.sectionsStored;
+                stats.sectionsSampled += chunkSections;
+            }
+            
+            // Chunks loaded from the store weren't meshed here.
+            const MeshCount& counted = batch[i].stats.meshCounted;
+            if (!batch[i].storedMesh.owner) {
+                stats.meshesCounted++;
+                if (counted.vertices != batch[i].VertexCount() || counted.indices != batch[i].Mesh().indexCount) stats.countMismatches++;
+            }
+            stats.densitySeconds += batch[i].stats.densitySeconds;
+            stats.meshSeconds += batch[i].stats.meshSeconds;
+        }
+    }
+    return stats;
+}
+
+// Startup time for the same region on 1..N threads.
+static void runScaling(int originX, int originZ, int width, int depth) {
+    unsigned int maxThreads = std::thread::hardware_concurrency();
+    if (maxThreads == 0) maxThreads = 4;
+    
+    double baseline = 0.0;
+    std::cout << "threads  seconds  chunks/s  speedup\n";
+    
+    for (unsigned int threads = 1; threads <= maxThreads; threads++) {
+        JobSystem::Initialize(threads);
+        heightfieldCache.Clear();
+        densityTileCache.Clear();
+        
+        BakeStats stats = bakeRegion(originX, originZ, width, depth, nullptr);
+        if (threads == 1) baseline = stats.generationSeconds;
+        
+        std::cout << threads << "  " << stats.generationSeconds << "  " << stats.chunks / stats.generationSeconds
+                  << "  " << baseline / stats.generationSeconds << "x\n";
+    }
+}
+
+// Single-chunk latency on 1..N threads (N from --threads, or one per core).
+// Each chunk of the region is generated on its own, with the tile caches
+// emptied first, so density and meshing are the only work in flight and every
+// thread count does the same work. Meshes must match the ones built on one thread.
+static int runLatency(int originX, int originZ, int width, int depth, int lod, unsigned int maxThreads) {
+    if (maxThreads == 0) maxThreads = std::thread::hardware_concurrency();
+    if (maxThreads == 0) maxThreads = 4;
+    
+    auto median = [](std::vector<double>& values) {
+        std::sort(values.begin(), values.end());
+        return values[values.size() / 2] * 1000.0;
+    };
+    
+    std::vector<uint64_t> reference;
+    double baseline = 0.0;
+    int mismatches = 0;
+    Terrain terrain;
+    
+    std::cout << "threads  ms/chunk  density ms  mesh ms  speedup (medians)\n";
+    for (unsigned int threads = 1; threads <= maxThreads; threads++) {
+        JobSystem::Initialize(threads);
+        std::vector<double> total, density, mesh;
+        
+        for (int i = 0; i < width * depth; i++) {
+            heightfieldCache.Clear();
+            densityTileCache.Clear();
+            
+            auto start = std::chrono::steady_clock::now();
+            terrain.Generate(originX + i / depth, originZ + i % depth, lod);
+            total.push_back(std::chrono::duration<double>(std::chrono::steady_clock::now() - start).count());
+            density.push_back(terrain.stats.densitySeconds);
+            mesh.push_back(terrain.stats.meshSeconds);
+            
+            if (threads == 1) reference.push_back(terrain.MeshHash());
+            else if (terrain.MeshHash() != reference[i]) mismatches++;
+        }
+        
+        double milliseconds = median(total);
+        if (threads == 1) baseline = milliseconds;
+        std::printf("%7u %9.3f %11.3f %8.3f %7.2fx\n", threads, milliseconds, median(density), median(mesh), baseline / milliseconds);
+    }
+    
+    std::cout << "mesh mismatches " << mismatches << '\n';
+    return mismatches ? 1 : 0;
+}
+
+// Compares the batched cave-noise rows against scalar noiseLayer() over the
+// same coordinate ranges the density loop uses.
+static int checkNoise() {
+    const int rows = 4096;
+    const int width = 16;
+    float maxError = 0.0f;
+    
+    srand(1);
+    for (int r = 0; r < rows; r++) {
+        float rowSeed = (float)(rand() % 10000) * 10.23322f;
+        float x = (float)(rand() % 4096 + rowSeed) * 0.025f / 16.0f * 10.0f;
+        float y = (float)(rand() % 256) * 0.025f / 16.0f * 10.0f;
+        
+        float z[width], batched[width];
+        for (int i = 0; i < width; i++) z[i] = (float)(i + rowSeed + (rand() % 512) * 8) * 0.025f / 16.0f * 10.0f;
+        
+        noiseLayerRow(x, y, z, batched, width, 1.5, 0.6, 10);
+        for (int i = 0; i < width; i++) {
+            float reference = noiseLayer(x, y, 1.5, 0.6, 10, z[i]);
+            maxError = std::max(maxError, std::abs(reference - batched[i]));
+        }
+    }
+    
+    std::cout << noiseIsaName(noiseIsa) << ": max |error| " << maxError << " over " << rows * width
+              << " points (tolerance " << noiseRowTolerance << ")\n";
+    return maxError <= noiseRowTolerance ? 0 : 1;
+}
+
+// Digs and fills random spheres on the surface of one chunk. Each edit's
+// partial remesh is timed against rebuilding the whole mesh from the same
+// density, and the two are checked to produce the same triangles. The chunk is
+// then generated with the first edit and given the rest one at a time,
+// dropping its density before each, with every kind of density retention.
+// Full and Discard must end with exactly the density and triangles of the
+// chunk given every edit directly; the lossy modes with as many triangles.
+static int runEditBench(int chunkX, int chunkZ, int edits) {
+    Terrain terrain;
+    terrain.Generate(chunkX, chunkZ);
+    terrain.RemeshDirty();
+    
+    double editSeconds = 0.0, rebuildSeconds = 0.0;
+    int slabs = 0, mismatches = 0;
+    std::vector<TerrainEdit> applied;
+    
+    srand(1);
+    for (int i = 0; i < edits; i++) {
+        int x = rand() % chunkWidth, z = rand() % chunkWidth;
+        int y = chunkHeight - 1;
+        while (y > 0 && terrain.density.At(x, y, z) >= 0.0f) y--;
+        
+        TerrainEdit edit;
+        edit.operation = i % 2 ? EditOperation::Fill : EditOperation::Dig;
+        edit.center = terrain.position + glm::vec3(x * 2.0f, y, z * 2.0f);
+        edit.radius = 2.0f + rand() % 4;
+        applied.push_back(edit);
+        
+        auto start = std::chrono::steady_clock::now();
+        int remeshed = terrain.stats.slabsRemeshed;
+        if (terrain.ApplyEdit(edit)) terrain.RemeshDirty();
+        editSeconds += std::chrono::duration<double>(std::chrono::steady_clock::now() - start).count();
+        slabs += terrain.stats.slabsRemeshed - remeshed;
+        
+        Terrain rebuilt;
+        rebuilt.Place(chunkX, chunkZ);
+        rebuilt.density = terrain.density;
+        rebuilt.ComputeBrickRanges();
+        
+        start = std::chrono::steady_clock::now();
+        rebuilt.BuildMesh();
+        rebuildSeconds += std::chrono::duration<double>(std::chrono::steady_clock::now() - start).count();
+        
+        // A single pass shares vertices across slab boundaries, so the
+        // triangles are compared with every slab remeshed instead.
+        rebuilt.RemeshDirty();
+        if (rebuilt.TriangleHash() != terrain.TriangleHash()) mismatches++;
+    }
+    
+    DensityRetention retention = densityRetention;
+    int replayMismatches = 0;
+    
+    densityRetention = DensityRetention::Full;
+    Terrain direct;
+    direct.Generate(chunkX, chunkZ);
+    for (const TerrainEdit& edit : applied) {
+        if (direct.ApplyEdit(edit)) direct.RemeshDirty();
+    }
+    
+    for (DensityRetention mode : {DensityRetention::Full, DensityRetention::Discard, DensityRetention::Half, DensityRetention::Compressed}) {
+        densityRetention = mode;
+        
+        Terrain replayed;
+        replayed.Generate(chunkX, chunkZ, 0, {applied[0]});
+        for (size_t i = 1; i < applied.size(); i++) {
+            replayed.RetainDensity();
+            if (replayed.ApplyEdit(applied[i])) replayed.RemeshDirty();
+        }
+        bool exact = mode == DensityRetention::Full || mode == DensityRetention::Discard;
+        if (exact ? replayed.DensityHash() != direct.DensityHash() || replayed.TriangleHash() != direct.TriangleHash()
+                  : replayed.TriangleCount() != direct.TriangleCount()) replayMismatches++;
+    }
+    densityRetention = retention;
+    
+    std::cout << edits << " edits, " << slabs / (double)edits << " of " << terrain.slabs.size() << " slabs remeshed per edit\n";
+    std::cout << "edit + remesh " << editSeconds / edits * 1000.0 << " ms, full rebuild " << rebuildSeconds / edits * 1000.0
+              << " ms (" << rebuildSeconds / editSeconds << "x)\n";
+    std::cout << "triangle mismatches " << mismatches << ", after generating with edits " << replayMismatches << " of 4 retention modes\n";
+    return mismatches || replayMismatches ? 1 : 0;
+}
+
+// Meshes the same densities with per-row sign masks and with the per-cube
+// corner loop, with and without brick skipping, and checks that every variant
+// builds the identical mesh.
+static int runMeshBench(int originX, int originZ, int width, int depth, int lod, int repeats) {
+    DensityRetention retention = densityRetention;
+    densityRetention = DensityRetention::Full;
+    
+    std::vector<Terrain> terrains(width * depth);
+    for (int i = 0; i < width * depth; i++) terrains[i].Generate(originX + i / depth, originZ + i % depth, lod);
+    densityRetention = retention;
+    
+    std::vector<uint64_t> reference;
+    for (const Terrain& terrain : terrains) reference.push_back(terrain.MeshHash());
+    
+    bool savedSignMasks = signMasks, savedBrickSkipping = brickSkipping;
+    double cornerSeconds = 0.0;
+    int mismatches = 0;
+    
+    std::cout << "mesher         bricks  ms/chunk  cubes visited  speedup\n";
+    for (bool bricks : {true, false}) {
+        for (bool masks : {false, true}) {
+            signMasks = masks;
+            brickSkipping = bricks;
+            uint64_t visited = 0;
+            
+            auto start = std::chrono::steady_clock::now();
+            for (int repeat = 0; repeat < repeats; repeat++) {
+                for (size_t i = 0; i < terrains.size(); i++) {
+                    terrains[i].BuildMesh();
+                    visited += terrains[i].stats.cubesVisited;
+                    if (terrains[i].MeshHash() != reference[i]) mismatches++;
+                }
+            }
+            double seconds = std::chrono::duration<double>(std::chrono::steady_clock::now() - start).count();
+            if (!masks) cornerSeconds = seconds;
+            
+            std::printf("%-14s %-6s %9.3f %14llu %8.2fx\n", masks ? "sign masks" : "cube corners", bricks ? "on" : "off",
+                        seconds / (repeats * terrains.size()) * 1000.0, (unsigned long long)(visited / repeats), cornerSeconds / seconds);
+        }
+    }
+    
+    signMasks = savedSignMasks;
+    brickSkipping = savedBrickSkipping;
+    std::cout << "mesh mismatches " << mismatches << '\n';
+    return mismatches ? 1 : 0;
+}
+
+// Packs each chunk's density as Half and Compressed and unpacks it again, along
+// with values at the edges of the half range. Every point must keep its side of
+// the surface; Half must stay within half precision, Compressed within it
+// inside the band.
+static int runDensityCheck(int originX, int originZ, int width, int depth, int lod) {
+    DensityRetention retention = densityRetention;
+    densityRetention = DensityRetention::Full;
+    
+    int64_t points = 0, flips = 0;
+    float maxError[2] = {0.0f, 0.0f};
+    
+    const float edges[] = {-1e-30f, -1e-6f, -6e-8f, -0.0f, 0.0f, 6e-8f, 1e-6f, -65504.0f, 65504.0f, -1e6f, 1e6f};
+    for (float value : edges) {
+        if ((value < 0.0f) != (halfToFloat(floatToHalf(value)) < 0.0f)) flips++;
+    }
+    
+    DensityField unpacked;
+    for (int i = 0; i < width * depth; i++) {
+        Terrain terrain;
+        terrain.Generate(originX + i / depth, originZ + i % depth, lod);
+        
+        for (int m = 0; m < 2; m++) {
+            PackedDensity packed;
+            packed.Pack(terrain.density, m ? DensityRetention::Compressed : DensityRetention::Half);
+            packed.Unpack(unpacked);
+            
+            for (int x = 0; x < chunkWidth; x++) {
+                for (int y = 0; y < chunkHeight; y++) {
+                    const float* original = terrain.density.Row(x, y);
+                    const float* row = unpacked.Row(x, y);
+                    for (int z = 0; z < chunkWidth; z++) {
+                        if ((original[z] < 0.0f) != (row[z] < 0.0f)) flips++;
+                        if (m && fabs(original[z]) >= compressedDensityBand) continue;
+                        
+                        // Half keeps 11 significant bits.
+                        float error = fabsf(original[z] - row[z]) / std::max(fabsf(original[z]), 1.0f);
+                        maxError[m] = std::max(maxError[m], error);
+                    }
+                }
+            }
+            points += chunkWidth * chunkHeight * chunkWidth;
+        }
+    }
+    densityRetention = retention;
+    
+    bool precise = maxError[0] <= 1.0f / 2048.0f && maxError[1] <= 1.0f / 2048.0f;
+    std::cout << points / 2 << " points packed twice: max relative error half " << maxError[0] << ", compressed " << maxError[1]
+              << ", sign changes " << flips << '\n';
+    return flips || !precise ? 1 : 0;
+}
+
+// Generates the region with every cave octave and again with bounded
+// evaluation. Meshes must match, also after a dig and a fill where the surface
+// crosses each chunk's centre column. Bounded chunks are also saved to a
+// scratch chunk store with compressed density, loaded back and given the same
+// edits, which must build the same meshes as the chunk that was saved.
+static int runOctaveCheck(int originX, int originZ, int width, int depth, int lod) {
+    DensityRetention retention = densityRetention;
+    bool savedCulling = octaveCulling;
+    densityRetention = DensityRetention::Full;
+    
+    std::string savedRoot = chunkStore.root;
+    bool savedEnabled = chunkStore.enabled;
+    std::string storeRoot = (std::filesystem::temp_directory_path() / "bake-octave-check").string();
+    std::error_code error;
+    std::filesystem::remove_all(storeRoot, error);
+    ChunkStore::Open(storeRoot);
+    
+    std::vector<std::array<uint64_t, 3>> reference;
+    int mismatches = 0, storeMismatches = 0;
+    
+    std::cout << "octaves  density ms/chunk  octaves/voxel  rows refined\n";
+    for (bool bounded : {false, true}) {
+        octaveCulling = bounded;
+        heightfieldCache.Clear();
+        densityTileCache.Clear();
+        
+        double seconds = 0.0;
+        int64_t voxels = 0, octaves = 0, refined = 0;
+        
+        for (int i = 0; i < width * depth; i++) {
+            Terrain terrain;
+            terrain.Generate(originX + i / depth, originZ + i % depth, lod);
+            seconds += terrain.stats.densitySeconds;
+            voxels += terrain.stats.voxelsSampled;
+            octaves += terrain.stats.octavesSampled;
+            
+            std::array<uint64_t, 3> hashes = {terrain.MeshHash()};
+            TerrainEdit edits[2];
+            for (int e = 0; e < 2; e++) {
+                int y = chunkHeight - 1;
+                while (y > 0 && terrain.density.At(chunkWidth / 2, y, chunkWidth / 2) >= 0.0f) y--;
+                
+                edits[e].operation = e ? EditOperation::Fill : EditOperation::Dig;
+                edits[e].center = terrain.position + glm::vec3(chunkWidth, y, chunkWidth);
+                edits[e].radius = 5.0f;
+                if (terrain.ApplyEdit(edits[e])) terrain.BuildMesh();
+                hashes[e + 1] = terrain.MeshHash();
+            }
+            refined += terrain.stats.rowsRefined;
+            
+            if (!bounded) reference.push_back(hashes);
+            else if (hashes != reference[i]) mismatches++;
+            if (!bounded) continue;
+            
+            densityRetention = DensityRetention::Compressed;
+            Terrain saved, loaded;
+            saved.Generate(originX + i / depth, originZ + i % depth, lod);
+            chunkStore.Save(saved);
+            bool hit = chunkStore.Load(saved.chunkX, saved.chunkZ, lod, loaded);
+            densityRetention = DensityRetention::Full;
+            
+            for (const TerrainEdit& edit : edits) {
+                if (saved.ApplyEdit(edit)) saved.BuildMesh();
+                if (loaded.ApplyEdit(edit)) loaded.BuildMesh();
+            }
+            if (!hit || saved.MeshHash() != loaded.MeshHash()) storeMismatches++;
+        }
+        
+        std::printf("%-8s %17.3f %14.2f %13lld\n", bounded ? "bounded" : "full", seconds / (width * depth) * 1000.0,
+                    octaves / (double)std::max<int64_t>(voxels, 1), (long long)refined);
+    }
+    
+    octaveCulling = savedCulling;
+    densityRetention = retention;
+    std::filesystem::remove_all(storeRoot, error);
+    chunkStore.root = savedRoot;
+    chunkStore.enabled = savedEnabled;
+    
+    std::cout << "mesh mismatches " << mismatches << ", after loading from the chunk store " << storeMismatches << '\n';
+    return mismatches || storeMismatches ? 1 : 0;
+}
+
+// Frustum-culls the region's chunk bounds from random cameras inside it. Every
+// culled box is checked by projecting a grid of points inside it; none may
+// land in clip space.
+static int runCullBench(int originX, int originZ, int width, int depth, int cameras) {
+    std::vector<AABB> boxes;
+    Terrain terrain;
+    for (int x = originX; x < originX + width; x++) {
+        for (int z = originZ; z < originZ + depth; z++) {
+            loadOrGenerateChunk(terrain, x, z);
+            boxes.push_back(terrain.bounds);
+        }
+    }
+    
+    glm::mat4 projection = glm::perspective(3.14159265358f/2.0f, 3.0f/2.0f, 0.1f, 1000.0f);
+    uint64_t tests = 0, culled = 0, falseCulls = 0;
+    double seconds = 0.0;
+    
+    srand(1);
+    for (int c = 0; c < cameras; c++) {
+        glm::vec3 eye = glm::vec3(originX * chunkWidth + rand() % (width * chunkWidth), 20 + rand() % 100, originZ * chunkWidth + rand() % (depth * chunkWidth));
+        float yaw = (rand() % 6283) / 1000.0f, pitch = (rand() % 3000) / 1000.0f - 1.5f;
+        glm::vec3 look = glm::vec3(cos(yaw) * cos(pitch), sin(pitch), sin(yaw) * cos(pitch));
+        
+        glm::mat4 viewProjection = projection * glm::lookAt(eye, eye + look, glm::vec3(0.0f, 1.0f, 0.0f));
+        Frustum frustum = Frustum::FromMatrix(viewProjection);
+        
+        std::vector<char> visible(boxes.size());
+        auto start = std::chrono::steady_clock::now();
+        for (size_t i = 0; i < boxes.size(); i++) visible[i] = frustum.Intersects(boxes[i]);
+        seconds += std::chrono::duration<double>(std::chrono::steady_clock::now() - start).count();
+        
+        for (size_t i = 0; i < boxes.size(); i++) {
+            tests++;
+            if (visible[i] || boxes[i].Empty()) continue;
+            culled++;
+            
+            for (int sample = 0; sample < 125; sample++) {
+                glm::vec3 t = glm::vec3(sample % 5, sample / 5 % 5, sample / 25) / 4.0f;
+                glm::vec4 clip = viewProjection * glm::vec4(boxes[i].min + (boxes[i].max - boxes[i].min) * t, 1.0f);
+                
+                if (fabs(clip.x) <= clip.w && fabs(clip.y) <= clip.w && fabs(clip.z) <= clip.w) {
+                    falseCulls++;
+                    break;
+                }
+            }
+        }
+    }
+    
+    std::cout << cameras << " cameras x " << boxes.size() << " chunks: " << 100.0 * culled / tests << "% culled, "
+              << seconds / tests * 1e9 << " ns per test, " << falseCulls << " false culls\n";
+    return falseCulls ? 1 : 0;
+}
+
+// Occlusion culling from random views just above the ground, looking roughly
+// level, as the window would do it. A chunk was wrongly occluded if its mesh,
+// drawn on its own, is in front of (or level with) every chunk's mesh at some
+// pixel. The pass runs with and without SIMD, which must agree.
+static int runOcclusionBench(int originX, int originZ, int width, int depth, int lod, int cameras) {
+    const float occluderDistance = 96.0f;
+    
+    // Exact positions, so the reference meshes are where the occluders were built from.
+    VertexFormat format = vertexFormat;
+    vertexFormat = VertexFormat::Full;
+    std::vector<Terrain> terrains(width * depth);
+    for (int i = 0; i < width * depth; i++) loadOrGenerateChunk(terrains[i], originX + i / depth, originZ + i % depth, lod);
+    vertexFormat = format;
+    
+    auto drawMesh = [](OcclusionBuffer& buffer, const Terrain& terrain) {
+        MeshView mesh = terrain.Mesh();
+        const Vertex* vertices = static_cast<const Vertex*>(mesh.vertices);
+        size_t count = mesh.indexCount ? mesh.indexCount : mesh.vertexCount;
+        
+        for (size_t i = 0; i + 2 < count; i += 3) {
+            size_t a = mesh.indexCount ? mesh.indices[i] : i;
+            size_t b = mesh.indexCount ? mesh.indices[i + 1] : i + 1;
+            size_t c = mesh.indexCount ? mesh.indices[i + 2] : i + 2;
+            buffer.AddTriangle(vertices[a].vertex + terrain.position, vertices[b].vertex + terrain.position, vertices[c].vertex + terrain.position);
+        }
+    };
+    
+    glm::mat4 projection = glm::perspective(3.14159265358f/2.0f, 3.0f/2.0f, 0.1f, 1000.0f);
+    OcclusionBuffer occlusion, reference, single;
+    OcclusionStats modes[2];
+    uint64_t tested = 0, occluded = 0, wrong = 0, disagreements = 0;
+    
+    srand(1);
+    for (int c = 0; c < cameras; c++) {
+        glm::vec3 eye = glm::vec3(originX * chunkWidth + rand() % (width * chunkWidth), 0.0f, originZ * chunkWidth + rand() % (depth * chunkWidth));
+        float ground = 0.0f;
+        for (const Terrain& terrain : terrains) {
+            if (eye.x < terrain.bounds.min.x || eye.x > terrain.bounds.max.x || eye.z < terrain.bounds.min.z || eye.z > terrain.bounds.max.z) continue;
+            for (const Vertex& vertex : terrain.vertices) {
+                glm::vec3 point = vertex.vertex + terrain.position;
+                if (fabs(point.x - eye.x) <= 3.0f && fabs(point.z - eye.z) <= 3.0f) ground = std::max(ground, point.y);
+            }
+        }
+        eye.y = ground + 2.0f + rand() % 10;
+        
+        float yaw = (rand() % 6283) / 1000.0f, pitch = (rand() % 500) / 1000.0f - 0.35f;
+        glm::vec3 look = glm::vec3(cos(yaw) * cos(pitch), sin(pitch), sin(yaw) * cos(pitch));
+        glm::mat4 viewProjection = projection * glm::lookAt(eye, eye + look, glm::vec3(0.0f, 1.0f, 0.0f));
+        Frustum frustum = Frustum::FromMatrix(viewProjection);
+        
+        std::vector<const Terrain*> inFrustum;
+        for (const Terrain& terrain : terrains) {
+            if (frustum.Intersects(terrain.bounds)) inFrustum.push_back(&terrain);
+        }
+        
+        std::vector<const Terrain*> visible[2];
+        for (int simd = 0; simd < 2; simd++) {
+            occlusion.simd = simd;
+            visible[simd] = inFrustum;
+            OcclusionStats stats = cullOccluded(occlusion, viewProjection, eye, occluderDistance, visible[simd]);
+            
+            modes[simd].occluders += stats.occluders;
+            modes[simd].triangles += stats.triangles;
+            modes[simd].rasterSeconds += stats.rasterSeconds;
+            modes[simd].pyramidSeconds += stats.pyramidSeconds;
+            modes[simd].testSeconds += stats.testSeconds;
+        }
+        if (visible[0] != visible[1]) disagreements++;
+        
+        tested += inFrustum.size();
+        occluded += inFrustum.size() - visible[1].size();
+        
+        reference.Begin(viewProjection, eye);
+        for (const Terrain* terrain : inFrustum) drawMesh(reference, *terrain);
+        
+        for (const Terrain* terrain : inFrustum) {
+            if (std::find(visible[1].begin(), visible[1].end(), terrain) != visible[1].end()) continue;
+            
+            single.Begin(viewProjection, eye);
+            drawMesh(single, *terrain);
+            
+            bool seen = false;
+            for (int y = 0; y < OcclusionBuffer::height && !seen; y++) {
+                for (int x = 0; x < OcclusionBuffer::width && !seen; x++) {
+                    seen = single.Depth(x, y) > 0.0f && single.Depth(x, y) >= reference.Depth(x, y);
+                }
+            }
+            wrong += seen;
+        }
+    }
+    
+    std::cout << cameras << " views x " << terrains.size() << " chunks: " << occluded << " of " << tested << " chunks in the frustum occluded ("
+              << 100.0 * occluded / std::max<uint64_t>(tested, 1) << "%, " << occluded / (double)cameras << " per view), "
+              << modes[1].occluders / (double)cameras << " occluder chunks and " << modes[1].triangles / (double)cameras << " triangles per view\n";
+    
+    const char* names[2] = {"scalar", "sse4.1"};
+    for (int simd = 0; simd < (NOISE_SIMD_X86 ? 2 : 1); simd++) {
+        const OcclusionStats& mode = modes[simd];
+        double total = mode.rasterSeconds + mode.pyramidSeconds + mode.testSeconds;
+        std::printf("%-7s %8.1f us per view: raster %.1f, pyramid %.1f, tests %.1f\n", names[simd], total / cameras * 1e6,
+                    mode.rasterSeconds / cameras * 1e6, mode.pyramidSeconds / cameras * 1e6, mode.testSeconds / cameras * 1e6);
+    }
+    
+    std::cout << "wrongly occluded " << wrong << ", scalar/simd disagreements " << disagreements << '\n';
+    return wrong || disagreements ? 1 : 0;
+}
+
+struct ChunkHash {
+    int x, z;
+    uint64_t mesh, density;
+    size_t triangles;
+};
+
+// Generates every chunk of the region on the given number of threads, with
+// cold caches and full density kept so both hashes see exactly what was meshed.
+static std::vector<ChunkHash> hashRegion(int originX, int originZ, int width, int depth, int lod, unsigned int threads) {
+    JobSystem::Initialize(threads);
+    heightfieldCache.Clear();
+    densityTileCache.Clear();
+    
+    DensityRetention retention = densityRetention;
+    densityRetention = DensityRetention::Full;
+    
+    std::vector<ChunkHash> hashes(width * depth);
+    JobGroup chunks;
+    for (int i = 0; i < width * depth; i++) {
+        int x = originX + i / depth, z = originZ + i % depth;
+        ChunkHash* hash = &hashes[i];
+        jobSystem.Submit(chunks, [=]() {
+            Terrain terrain;
+            terrain.Generate(x, z, lod);
+            *hash = {x, z, terrain.MeshHash(), terrain.DensityHash(), terrain.TriangleCount()};
+        });
+    }
+    jobSystem.Wait(chunks);
+    
+    densityRetention = retention;
+    return hashes;
+}
+
+// Everything the hashes depend on besides the generator itself; a golden file
+// recorded under other settings can't be compared.
+static std::string goldenSettings(int lod) {
+    std::ostringstream settings;
+    settings << "seed " << seed << " world " << std::hex << worldFingerprint() << std::dec
+             << " noise " << noiseIsaName(noiseIsa) << " mesh " << (meshMode == MeshMode::Indexed ? "indexed" : "flat")
+             << " vertex " << (vertexFormat == VertexFormat::Packed ? "packed" : "full") << " lod " << lod
+             << " chunk " << chunkWidth << "x" << chunkHeight << " sections " << sectionSize;
+    
+    // Bounded evaluation leaves the density exact in sign only away from the surface.
+    if (octaveCulling) settings << " octaves bounded";
+    return settings.str();
+}
+
+// Hashes the region on one thread and again on every core; the two passes must
+// match bit for bit. Then either records the hashes or checks them against a
+// golden file recorded earlier by a trusted build.
+static int runGolden(const std::string& path, bool write, int originX, int originZ, int width, int depth, int lod) {
+    unsigned int maxThreads = std::max(std::thread::hardware_concurrency(), 2u);
+    
+    std::vector<ChunkHash> single = hashRegion(originX, originZ, width, depth, lod, 1);
+    std::vector<ChunkHash> threaded = hashRegion(originX, originZ, width, depth, lod, maxThreads);
+    
+    int failures = 0;
+    for (size_t i = 0; i < single.size(); i++) {
+        if (single[i].mesh != threaded[i].mesh || single[i].density != threaded[i].density) {
+            std::cout << "chunk " << single[i].x << " " << single[i].z << " differs between 1 and " << maxThreads << " threads\n";
+            failures++;
+        }
+    }
+    
+    std::string settings = goldenSettings(lod);
+    
+    if (write) {
+        std::ofstream file(path);
+        file << "# " << settings << '\n';
+        for (const ChunkHash& hash : single) {
+            file << hash.x << ' ' << hash.z << ' ' << std::hex << hash.mesh << ' ' << hash.density << std::dec << ' ' << hash.triangles << '\n';
+        }
+        std::cout << "wrote " << single.size() << " chunk hashes to " << path << " (" << settings << ")\n";
+        return failures ? 1 : 0;
+    }
+    
+    std::ifstream file(path);
+    std::string header;
+    if (!file || !std::getline(file, header)) {
+        std::cout << "could not read " << path << '\n';
+        return 1;
+    }
+    if (header != "# " + settings) {
+        std::cout << path << " was recorded with different settings:\n  " << header.substr(2) << "\n  " << settings << '\n';
+        return 1;
+    }
+    
+    size_t checked = 0;
+    ChunkHash golden;
+    while (file >> golden.x >> golden.z >> std::hex >> golden.mesh >> golden.density >> std::dec >> golden.triangles) {
+        auto found = std::find_if(single.begin(), single.end(), [&](const ChunkHash& hash) { return hash.x == golden.x && hash.z == golden.z; });
+        if (found == single.end()) continue;
+        checked++;
+        
+        if (found->mesh != golden.mesh || found->density != golden.density) {
+            std::cout << "chunk " << golden.x << " " << golden.z << ":" << (found->density != golden.density ? " density" : "")
+                      << (found->mesh != golden.mesh ? " mesh" : "") << " changed, " << golden.triangles << " -> " << found->triangles << " triangles\n";
+            failures++;
+        }
+    }
+    
+    std::cout << checked << "/" << single.size() << " chunks checked against " << path << ", " << failures << " mismatches\n";
+    return failures || checked < single.size() ? 1 : 0;
+}
+
+// Bakes the region to grow the scratch arenas, the section pool and the
+// batch's terrains, with both tile caches shrunk so that they are full and
+// evicting, then bakes it again with the same terrains, counting the heap
+// allocations made while chunks generate. Each thread's arenas grow with the
+// chunks that thread happens to get, so with several threads it can take a
+// few passes before one allocates nothing. Also checks each mesh against the
+// size CountMesh predicted for it.
+static int runAllocCheck(int originX, int originZ, int width, int depth, int lod) {
+    const size_t tileCapacity = 64;
+    const int maxPasses = 8;
+    size_t heightfieldCapacity = heightfieldCache.capacity, densityCapacity = densityTileCache.capacity;
+    heightfieldCache.Clear();
+    densityTileCache.Clear();
+    heightfieldCache.capacity = tileCapacity;
+    densityTileCache.capacity = tileCapacity;
+    chunkStore.enabled = false;
+    
+    std::vector<Terrain> batch;
+    BakeStats warmup = bakeRegion(originX, originZ, width, depth, nullptr, lod, BakeOrder::Rows, &batch);
+    BakeStats steady;
+    uint64_t mismatches = warmup.countMismatches, meshes = warmup.meshesCounted;
+    int passes = 1;
+    do {
+        steady = bakeRegion(originX, originZ, width, depth, nullptr, lod, BakeOrder::Rows, &batch);
+        mismatches += steady.countMismatches;
+        meshes += steady.meshesCounted;
+        passes++;
+    } while (steady.allocations && passes < maxPasses);
+    
+    heightfieldCache.capacity = heightfieldCapacity;
+    densityTileCache.capacity = densityCapacity;
+    
+    std::cout << "heap allocations per chunk: " << warmup.allocations / (double)warmup.chunks << " warming up, "
+              << steady.allocations / (double)steady.chunks << " on pass " << passes << " (" << steady.allocations << " over "
+              << steady.chunks << " chunks, " << jobSystem.ThreadCount() << " threads, " << tileCapacity << "-tile caches, "
+              << densityTileCache.misses << " tile misses)\n";
+    std::cout << "mesh pre-count mismatches " << mismatches << "/" << meshes << '\n';
+    return steady.allocations || mismatches ? 1 : 0;
+}
+
+int main(int argc, const char * argv[]) {
+    
+    seed = 0.0f;
+    int width = 20, depth = 20;
+    int originX = -10, originZ = -10;
+    std::string outPath = "world.mctb";
+    unsigned int threads = 0;
+    bool scaling = false, latency = false;
+    bool prune = false;
+    int editBench = 0;
+    int cullBench = 0;
+    int occlusionBench = 0;
+    bool densityCheck = false;
+    int meshBench = 0;
+    int lod = 0;
+    BakeOrder order = BakeOrder::Rows;
+    std::string goldenPath;
+    std::string tracePath;
+    bool goldenWrite = false;
+    bool graphDump = false;
+    bool octaveCheck = false;
+    bool allocCheck = false;
+    
+    for (int i = 1; i < argc; i++) {
+        if (!strcmp(argv[i], "--seed") && i + 1 < argc) {
+            seed = std::stof(argv[++i]);
+        }
+        else if (!strcmp(argv[i], "--config") && i + 1 < argc) {
+            if (!terrainParameters.Load(argv[++i])) {
+                std::cout << "could not load " << argv[i] << '\n';
+                return 1;
+            }
+        }
+        else if (!strcmp(argv[i], "--param") && i + 1 < argc) {
+            std::string setting = argv[++i];
+            size_t equals = setting.find('=');
+            if (equals == std::string::npos || !terrainParameters.Set(setting.substr(0, equals), setting.substr(equals + 1))) {
+                std::cout << "unknown parameter '" << setting << "'\n";
+                return 1;
+            }
+        }
+        else if (!strcmp(argv[i], "--graph") && i + 1 < argc) {
+            std::string error;
+            if (!DensityProgram::Load(argv[++i], densityGraph, error)) {
+                std::cout << error << '\n';
+                return 1;
+            }
+        }
+        else if (!strcmp(argv[i], "--graph-dump")) {
+            graphDump = true;
+        }
+        else if (!strcmp(argv[i], "--region") && i + 2 < argc) {
+            width = std::stoi(argv[++i]);
+            depth = std::stoi(argv[++i]);
+        }
+        else if (!strcmp(argv[i], "--origin") && i + 2 < argc) {
+            originX = std::stoi(argv[++i]);
+            originZ = std::stoi(argv[++i]);
+        }
+        else if (!strcmp(argv[i], "--out") && i + 1 < argc) {
+            outPath = argv[++i];
+        }
+        else if (!strcmp(argv[i], "--noise") && i + 1 < argc) {
+            std::string isa = argv[++i];
+            NoiseIsa requested;
+            if (isa == "scalar") requested = NoiseIsa::Scalar;
+            else if (isa == "sse4.1") requested = NoiseIsa::SSE41;
+            else if (isa == "avx2") requested = NoiseIsa::AVX2;
+            else {
+                printUsage();
+                return 1;
+            }
+            
+            // Forcing a wider instruction set than the CPU has would die on the first SIMD instruction.
+            NoiseIsa supported = detectNoiseIsa();
+            if (requested > supported) {
+                std::cout << "this CPU doesn't support " << isa << " (" << noiseIsaName(supported) << " at most)\n";
+                return 1;
+            }
+            noiseIsa = requested;
+        }
+        else if (!strcmp(argv[i], "--mesh") && i + 1 < argc) {
+            std::string mode = argv[++i];
+            if (mode == "flat") meshMode = MeshMode::Flat;
+            else if (mode == "indexed") meshMode = MeshMode::Indexed;
+            else {
+                printUsage();
+                return 1;
+            }
+        }
+        else if (!strcmp(argv[i], "--vertex") && i + 1 < argc) {
+            std::string format = argv[++i];
+            if (format == "full") vertexFormat = VertexFormat::Full;
+            else if (format == "packed") vertexFormat = VertexFormat::Packed;
+            else {
+                printUsage();
+                return 1;
+            }
+        }
+        else if (!strcmp(argv[i], "--bricks") && i + 1 < argc) {
+            brickSkipping = strcmp(argv[++i], "off") != 0;
+        }
+        else if (!strcmp(argv[i], "--parallel-mesh") && i + 1 < argc) {
+            parallelMeshing = strcmp(argv[++i], "off") != 0;
+        }
+        else if (!strcmp(argv[i], "--signs") && i + 1 < argc) {
+            signMasks = strcmp(argv[++i], "off") != 0;
+        }
+        else if (!strcmp(argv[i], "--octaves") && i + 1 < argc) {
+            octaveCulling = strcmp(argv[++i], "full") != 0;
+        }
+        else if (!strcmp(argv[i], "--octave-check")) {
+            octaveCheck = true;
+        }
+        else if (!strcmp(argv[i], "--alloc-check")) {
+            allocCheck = true;
+        }
+        else if (!strcmp(argv[i], "--density") && i + 1 < argc) {
+            std::string mode = argv[++i];
+            if (mode == "full") densityRetention = DensityRetention::Full;
+            else if (mode == "discard") densityRetention = DensityRetention::Discard;
+            else if (mode == "half") densityRetention = DensityRetention::Half;
+            else if (mode == "compressed") densityRetention = DensityRetention::Compressed;
+        }
+        else if (!strcmp(argv[i], "--lod") && i + 1 < argc) {
+            lod = std::clamp(std::stoi(argv[++i]), 0, maxLod);
+        }
+        else if (!strcmp(argv[i], "--order") && i + 1 < argc) {
+            order = strcmp(argv[++i], "spiral") ? BakeOrder::Rows : BakeOrder::Spiral;
+        }
+        else if (!strcmp(argv[i], "--cache") && i + 1 < argc) {
+            ChunkStore::Open(argv[++i]);
+        }
+        else if (!strcmp(argv[i], "--cache-prune")) {
+            prune = true;
+        }
+        else if (!strcmp(argv[i], "--threads") && i + 1 < argc) {
+            threads = std::stoi(argv[++i]);
+        }
+        else if (!strcmp(argv[i], "--edit-bench") && i + 1 < argc) {
+            editBench = std::max(std::stoi(argv[++i]), 1);
+        }
+        else if (!strcmp(argv[i], "--mesh-bench") && i + 1 < argc) {
+            meshBench = std::max(std::stoi(argv[++i]), 1);
+        }
+        else if (!strcmp(argv[i], "--density-check")) {
+            densityCheck = true;
+        }
+        else if (!strcmp(argv[i], "--occlusion-bench") && i + 1 < argc) {
+            occlusionBench = std::max(std::stoi(argv[++i]), 1);
+        }
+        else if (!strcmp(argv[i], "--cull-bench") && i + 1 < argc) {
+            cullBench = std::max(std::stoi(argv[++i]), 1);
+        }
+        else if ((!strcmp(argv[i], "--golden-write") || !strcmp(argv[i], "--golden-check")) && i + 1 < argc) {
+            goldenWrite = !strcmp(argv[i], "--golden-write");
+            goldenPath = argv[++i];
+        }
+        else if (!strcmp(argv[i], "--trace") && i + 1 < argc) {
+            tracePath = argv[++i];
+        }
+        else if (!strcmp(argv[i], "--scaling")) {
+            scaling = true;
+        }
+        else if (!strcmp(argv[i], "--latency")) {
+            latency = true;
+        }
+        else if (!strcmp(argv[i], "--check-noise")) {
+            return checkNoise();
+        }
+        else {
+            printUsage();
+            return 1;
+        }
+    }
+    
+    if (graphDump) {
+        std::cout << terrainParameters.DensityGraph();
+        return 0;
+    }
+    
+    std::string programError;
+    if (!densityProgram(terrainParameters, &programError)) {
+        std::cout << programError << '\n';
+        return 1;
+    }
+    
+    JobSystem::Initialize(threads);
+    
+    if (prune && chunkStore.enabled) {
+        std::cout << "pruned " << chunkStore.Prune() << " stale cache directories\n";
+    }
+    
+    if (scaling) {
+        runScaling(originX, originZ, width, depth);
+        return 0;
+    }
+    
+    if (latency) {
+        return runLatency(originX, originZ, width, depth, lod, threads);
+    }
+    
+    if (!goldenPath.empty()) {
+        return runGolden(goldenPath, goldenWrite, originX, originZ, width, depth, lod);
+    }
+    
+    if (editBench) {
+        return runEditBench(originX, originZ, editBench);
+    }
+    
+    if (meshBench) {
+        return runMeshBench(originX, originZ, width, depth, lod, meshBench);
+    }
+    
+    if (allocCheck) {
+        return runAllocCheck(originX, originZ, width, depth, lod);
+    }
+    
+    if (octaveCheck) {
+        return runOctaveCheck(originX, originZ, width, depth, lod);
+    }
+    
+    if (densityCheck) {
+        return runDensityCheck(originX, originZ, width, depth, lod);
+    }
+    
+    if (occlusionBench) {
+        return runOcclusionBench(originX, originZ, width, depth, lod, occlusionBench);
+    }
+    
+    if (cullBench) {
+        return runCullBench(originX, originZ, width, depth, cullBench);
+    }
+    
+    ChunkWriter writer = ChunkWriter::Open(outPath, seed, originX, originZ, width, depth);
+    if (!writer.IsOpen()) {
+        std::cout << "could not open " << outPath << '\n';
+        return 1;
+    }
+    
+    auto start = std::chrono::steady_clock::now();
+    BakeStats stats = bakeRegion(originX, originZ, width, depth, &writer, lod, order);
+    writer.Close();
+    
+    double totalSeconds = std::chrono::duration<double>(std::chrono::steady_clock::now() - start).count();
+    double voxels = (double)stats.chunks * chunkWidth * chunkHeight * chunkWidth;
+    double chunksPerArea = (256.0 / chunkWidth) * (256.0 / chunkWidth);
+    
+    std::cout << "noise " << noiseIsaName(noiseIsa) << ", " << jobSystem.ThreadCount() << " threads, seed " << seed << ", "
+              << stats.chunks << " chunks, " << stats.triangles << " triangles, " << stats.vertices << " vertices, "
+              << writer.bytesWritten / (1024.0 * 1024.0) << " MB -> " << outPath << '\n';
+    std::cout << "generation " << stats.generationSeconds << " s, total " << totalSeconds << " s\n";
+    std::cout << "chunks/s    " << stats.chunks / stats.generationSeconds << '\n';
+    std::cout << "voxels/s    " << voxels / stats.generationSeconds << '\n';
+    std::cout << "triangles/s " << stats.triangles / stats.generationSeconds << '\n';
+    std::cout << "density " << stats.densitySeconds << " s, meshing " << stats.meshSeconds << " s (summed over chunks)\n";
+    std::cout << "bricks skipped " << stats.bricksSkipped << "/" << stats.bricksTotal
+              << ", cubes visited " << stats.cubesVisited << ", skipped " << stats.cubesSkipped << '\n';
+    std::cout << "cave octaves per voxel " << stats.octavesSampled / (double)std::max<uint64_t>(stats.voxelsSampled, 1) << " of "
+              << densityProgram(terrainParameters)->VoxelOctaves() << " (" << (octaveCulling ? "bounded" : "full") << ", "
+              << stats.rowsRefined << " rows refined)\n";
+    std::cout << "chunk " << chunkWidth << "x" << chunkHeight << ": " << (stats.densitySeconds + stats.meshSeconds) / stats.chunks * 1000.0
+              << " ms per chunk, " << chunksPerArea << " draw calls and " << stats.generationSeconds / stats.chunks * chunksPerArea * 1000.0
+              << " ms of generation per 256x256 units, " << stats.sectionsStored << "/" << stats.sectionsSampled << " sections stored\n";
+    std::cout << "memory per loaded chunk " << stats.memoryBytes / (double)stats.chunks / 1024.0 << " KB, "
+              << stats.allocations / (double)stats.chunks << " heap allocations per chunk, mesh pre-count off for "
+              << stats.countMismatches << "/" << stats.meshesCounted << '\n';
+    if (chunkStore.enabled) {
+        std::cout << "chunk store " << chunkStore.hits << " hits, " << chunkStore.misses << " misses ("
+                  << chunkStore.stale << " stale), " << chunkStore.writes << " writes\n";
+    }
+    std::cout << "heightfield tiles " << heightfieldCache.hits << " hits, " << heightfieldCache.misses << " misses\n";
+    
+    uint64_t tileLookups = densityTileCache.hits + densityTileCache.misses;
+    std::cout << "density tiles " << densityTileCache.hits << " hits, " << densityTileCache.misses << " misses ("
+              << 100.0 * densityTileCache.hits / std::max<uint64_t>(tileLookups, 1) << "% shared, "
+              << (order == BakeOrder::Spiral ? "spiral" : "rows") << " order)\n";
+    
+    if (!tracePath.empty()) {
+#if TERRAIN_PROFILE
+        PROFILE_WRITE(tracePath);
+#else
+        std::cout << "built with NDEBUG, no trace recorded\n";
+#endif
+    }
+}
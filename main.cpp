@@ -10,5 +10,46 @@
 
 int main(int argc, const char * argv[]) {
     
+    // --seed, or a --config that sets seed, pins the world; otherwise every
+    // run gets a new seed.
+    for (int i = 1; i < argc; i++) {
+        if (!strcmp(argv[i], "--seed") && i + 1 < argc) {
+            try {
+                seed = std::stof(argv[++i]);
+            }
+            catch (const std::exception&) {
+                std::cout << "--seed takes a number, not '" << argv[i] << "'\n";
+                return 1;
+            }
+            seedFixed = true;
+        }
+        else if (!strcmp(argv[i], "--config") && i + 1 < argc) {
+            bool seedSet = false;
+            if (!terrainParameters.Load(argv[++i], &seedSet)) {
+                std::cout << "could not load " << argv[i] << '\n';
+                return 1;
+            }
+            seedFixed |= seedSet;
+        }
+        else if (!strcmp(argv[i], "--graph") && i + 1 < argc) {
+            std::string error;
+            if (!DensityProgram::Load(argv[++i], densityGraph, error)) {
+                std::cout << error << '\n';
+                return 1;
+            }
+        }
+        else {
+            std::cout << "unknown argument '" << argv[i] << "'\n"
+                      << "usage: terrain [--seed S] [--config file] [--graph file]\n";
+            return 1;
+        }
+    }
+    
+    std::string error;
+    if (!densityProgram(terrainParameters, &error)) {
+        std::cout << error << '\n';
+        return 1;
+    }
+    
     initialize();
 }
@@ -10,30 +10,18 @@
 
 GLFWwindow* window;
 
-float seed;
 float deltaTime = 0;
 
 int terrainSize = 20;
+bool seedFixed = false;
 
-#include <fstream>
-#include <sstream>
-#include <vector>
-
-#include <glm/glm.hpp>
-#include <glm/mat4x4.hpp>
-#include <glm/vec3.hpp>
-#include <glm/vec2.hpp>
-#include <glm/vec4.hpp>
-
-#include <glm/gtc/matrix_transform.hpp>
-
-#include "util/noise.h"
+#include "headless.h"
 #include "object/camera.h"
 
-#include "marchingCubeTable.h"
 #include "object/shader.h"
-#include "object/vertex.h"
-#include "object/terrain.h"
+#include "object/stagingRing.h"
+#include "object/terrainBatch.h"
+#include "object/chunkManager.h"
 
 void initialize() {
     glfwInit();
@@ -52,17 +40,19 @@ void initialize() {
     glewInit();
     glEnable(GL_DEPTH_TEST);
     
-    srand(static_cast<unsigned int>(std::time(nullptr)));
-    seed = (float)(rand() % 10000) * 10.23322f;
-    
-    std::vector<Terrain> terrain = std::vector<Terrain>();
-    for (int x = -terrainSize/2; x < terrainSize/2; x++) {
-        for (int z = -terrainSize/2; z < terrainSize/2; z++) {
-            Terrain t = Terrain::CreateTerrain(x, z);
-            terrain.push_back(t);
-        }
+    if (!seedFixed) {
+        srand(static_cast<unsigned int>(std::time(nullptr)));
+        seed = (float)(rand() % 10000) * 10.23322f;
     }
     
+    JobSystem::Initialize();
+    TerrainBatch::Initialize();
+    ChunkStore::Open("chunkcache");
+    
+    // terrainSize counts 16-unit chunks; wider chunks reach as far with fewer.
+    chunkManager.loadRadius = (terrainSize / 2 * 16 + chunkWidth - 1) / chunkWidth;
+    chunkManager.unloadRadius = chunkManager.loadRadius + 2;
+    
     Camera::Initialize();
     glfwSetCursorPosCallback(window, cursor_position_callback);
     
@@ -70,6 +60,7 @@ void initialize() {
     
     double previousTime = glfwGetTime();
     int frameCount = 0;
+    bool editHeld = false;
     
     while (!glfwWindowShouldClose(window)) {
         
@@ -81,19 +72,25 @@ void initialize() {
         movement.y = glfwGetKey(window, GLFW_KEY_S) == GLFW_PRESS ? -0.05f : 0;
         
         if (glfwGetKey(window, GLFW_KEY_E)) {
-            terrain = {};
+            chunkManager.Reset();
             srand(static_cast<unsigned int>(std::time(nullptr)));
             seed = (float)(rand() % 10000) * 10.23322f;
-            for (int x = -terrainSize/2; x < terrainSize/2; x++) {
-                for (int z = -terrainSize/2; z < terrainSize/2; z++) {
-                    Terrain t = Terrain::CreateTerrain(x, z);
-                    terrain.push_back(t);
-                }
-            }
         }
         
+        // F digs and G fills a sphere a little ahead of the camera, once per press.
+        bool dig = glfwGetKey(window, GLFW_KEY_F) == GLFW_PRESS;
+        bool fill = glfwGetKey(window, GLFW_KEY_G) == GLFW_PRESS;
+        if ((dig || fill) && !editHeld) {
+            TerrainEdit edit;
+            edit.operation = dig ? EditOperation::Dig : EditOperation::Fill;
+            edit.center = camera.position + camera.lookDirection * 12.0f;
+            edit.radius = 4.0f;
+            chunkManager.ApplyEdit(edit);
+        }
+        editHeld = dig || fill;
+        
         camera.Update(movement);
-        std::cout << camera.position.x << " " << camera.position.y << " " << camera.position.z << '\n';
+        chunkManager.Update(camera.position);
         
         glClearColor(0.6, 0.7, 0.9, 1.0);
         glClear(GL_COLOR_BUFFER_BIT | GL_DEPTH_BUFFER_BIT);
@@ -102,17 +99,30 @@ void initialize() {
         
         shader.SetMatrix4("projection", camera.projection);
         shader.SetMatrix4("lookAt", camera.lookAt);
-        for (Terrain t : terrain) {
-            t.Render(shader);
-        }
+        shader.SetInt("packedVertices", vertexFormat == VertexFormat::Packed);
+        chunkManager.Render(shader, camera.projection * camera.lookAt, camera.position);
         
         double currentTime = glfwGetTime();
         double previousDeltaTime = glfwGetTime();
         frameCount++;
         
         if (currentTime - previousTime >= 1.0) {
+            ArenaReport arena = terrainBatch.Report();
 
-            glfwSetWindowTitle(window, ("Raymarching FPS: " + std::to_string(frameCount)).c_str());
+            std::string title = "Raymarching FPS: " + std::to_string(frameCount) +
+                                " | " + std::to_string(chunkManager.loadedCount) + " chunks (" +
+                                std::to_string(chunkManager.drawnCount) + " drawn, " +
+                                std::to_string(chunkManager.culledCount) + " culled, " +
+                                std::to_string(chunkManager.occlusionStats.occluded) + " occluded in " +
+                                std::to_string((int)((chunkManager.occlusionStats.rasterSeconds + chunkManager.occlusionStats.pyramidSeconds +
+                                                      chunkManager.occlusionStats.testSeconds) * 1e6)) + " us, " +
+                                std::to_string(terrainBatch.drawCalls) + " draw calls), " +
+                                std::to_string(chunkManager.MemoryBytes() / (1024 * 1024)) + " MB, " +
+                                std::to_string(arena.usedBytes / (1024 * 1024)) + "/" + std::to_string(arena.reservedBytes / (1024 * 1024)) + " MB VRAM in " +
+                                std::to_string(arena.pages) + " pages, " + std::to_string((int)(arena.Fragmentation() * 100.0f)) + "% fragmented | last edit " +
+                                std::to_string(chunkManager.lastEditSeconds * 1000.0) + " ms, " +
+                                std::to_string(chunkManager.lastEditSlabs) + " slabs";
+            glfwSetWindowTitle(window, title.c_str());
 
             frameCount = 0;
             previousTime = currentTime;
@@ -125,5 +135,9 @@ void initialize() {
                 
         glfwPollEvents();
         glfwSwapBuffers(window);
+        PROFILE_FRAME();
     }
+    
+    chunkManager.Reset();
+    PROFILE_WRITE("trace.json");
 }
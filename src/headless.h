@@ -0,0 +1,58 @@
+//
+//  headless.h
+//  Marching Cube Terrain
+//
+//  Created by Dmitri Wamback on 2026-10-16.
+//
+//  Everything needed to sample and mesh chunks without a window or GL context.
+//  core.h builds the renderer on top of this; bake.cpp uses it on its own.
+//
+
+#ifndef headless_h
+#define headless_h
+
+#include <iostream>
+#include <fstream>
+#include <sstream>
+#include <vector>
+#include <array>
+#include <string>
+#include <chrono>
+#include <iomanip>
+#include <cstdint>
+#include <cstddef>
+#include <cstring>
+#include <bit>
+
+#include <glm/glm.hpp>
+#include <glm/mat4x4.hpp>
+#include <glm/vec3.hpp>
+#include <glm/vec2.hpp>
+#include <glm/vec4.hpp>
+
+#include <glm/gtc/matrix_transform.hpp>
+
+float seed;
+
+#include "util/hash.h"
+#include "util/profiler.h"
+#include "util/chunkDimensions.h"
+#include "util/noise.h"
+#include "util/noiseSimd.h"
+#include "util/densitySigns.h"
+#include "util/heightfield.h"
+#include "util/jobSystem.h"
+#include "util/frustum.h"
+#include "util/occlusion.h"
+#include "util/rangeAllocator.h"
+#include "marchingCubeTable.h"
+#include "object/vertex.h"
+#include "util/scratchArena.h"
+#include "util/densityField.h"
+#include "util/densityCodec.h"
+#include "util/densityGraph.h"
+#include "object/terrain.h"
+#include "util/chunkStore.h"
+#include "util/chunkWriter.h"
+
+#endif /* headless_h */
@@ -8,7 +8,7 @@
 #ifndef marchingCubeTable_h
 #define marchingCubeTable_h
 
-extern const int edgeTable[256] = {
+constexpr uint16_t edgeTable[256] = {
     0x0  , 0x109, 0x203, 0x30a, 0x406, 0x50f, 0x605, 0x70c,
     0x80c, 0x905, 0xa0f, 0xb06, 0xc0a, 0xd03, 0xe09, 0xf00,
     0x190, 0x99 , 0x393, 0x29a, 0x596, 0x49f, 0x795, 0x69c,
@@ -43,7 +43,7 @@ extern const int edgeTable[256] = {
     0x70c, 0x605, 0x50f, 0x406, 0x30a, 0x203, 0x109, 0x0
 };
 
-extern const int triTable[256][16] = {
+constexpr int8_t triTable[256][16] = {
     {-1, -1, -1, -1, -1, -1, -1, -1, -1, -1, -1, -1, -1, -1, -1, -1},
     {0, 8, 3, -1, -1, -1, -1, -1, -1, -1, -1, -1, -1, -1, -1, -1},
     {0, 1, 9, -1, -1, -1, -1, -1, -1, -1, -1, -1, -1, -1, -1, -1},
@@ -302,5 +302,35 @@ extern const int triTable[256][16] = {
     {-1, -1, -1, -1, -1, -1, -1, -1, -1, -1, -1, -1, -1, -1, -1, -1}
 };
 
+const glm::vec3 vertexOffsets[8] = {
+    {0, 0, 0},
+    {1, 0, 0},
+    {1, 1, 0},
+    {0, 1, 0},
+    {0, 0, 1},
+    {1, 0, 1},
+    {1, 1, 1},
+    {0, 1, 1}
+};
+
+const glm::ivec2 edgeVertexMap[12] = {
+    {0, 1}, {1, 2}, {2, 3}, {3, 0},
+    {4, 5}, {5, 6}, {6, 7}, {7, 4},
+    {0, 4}, {1, 5}, {2, 6}, {3, 7}
+};
+
+// Lattice edge owned by each cube edge: the corner it starts from (relative to
+// the cube) and the axis it runs along, so neighbouring cubes agree on an ID.
+const glm::ivec3 edgeBase[12] = {
+    {0, 0, 0}, {1, 0, 0}, {0, 1, 0}, {0, 0, 0},
+    {0, 0, 1}, {1, 0, 1}, {0, 1, 1}, {0, 0, 1},
+    {0, 0, 0}, {1, 0, 0}, {1, 1, 0}, {0, 1, 0}
+};
+
+const int edgeAxis[12] = {
+    0, 1, 0, 1,
+    0, 1, 0, 1,
+    2, 2, 2, 2
+};
 
 #endif /* marchingCubeTable_h */
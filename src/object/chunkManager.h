@@ -0,0 +1,365 @@
+//
+//  chunkManager.h
+//  Marching Cube Terrain
+//
+//  Created by Dmitri Wamback on 2026-10-16.
+//
+
+#ifndef chunkManager_h
+#define chunkManager_h
+
+#include <unordered_map>
+#include <algorithm>
+
+// Streams chunks in and out around the camera. Chunks inside loadRadius are
+// generated on the job system nearest first; chunks past unloadRadius are
+// dropped (cancelled if they haven't started yet). Finished meshes are uploaded
+// on the main thread in Update, bounded by uploadBudget seconds per frame.
+//
+// Each chunk is meshed at the level of detail for its distance from the camera
+// (past lodDistances[i] it uses lod i + 1). When the camera moves to another
+// chunk, loaded chunks whose level changed are queued for a rebuild; the old
+// mesh keeps rendering until the new one is uploaded in its place.
+//
+// Edits are applied straight away to every loaded chunk they touch (only the
+// affected slabs are remeshed and re-uploaded) and kept in a log, so chunks
+// built later, or in flight at the time, get them too.
+//
+// Terrains of unloaded chunks and replaced meshes are kept (up to
+// maxSpareTerrains) and regenerated in place by later builds, reusing their
+// buffers.
+
+struct Chunk {
+    glm::ivec2 coordinate;
+    std::unique_ptr<Terrain> terrain;
+    std::atomic<bool> cancelled{false};
+    bool uploaded = false;
+    bool building = false;
+    int lod = 0;
+};
+
+// A mesh built on a worker, waiting to be uploaded into its chunk. It
+// includes the first editCount edits of the log.
+struct ChunkBuild {
+    std::shared_ptr<Chunk> chunk;
+    std::unique_ptr<Terrain> terrain;
+    size_t editCount = 0;
+};
+
+class ChunkManager {
+public:
+    int loadRadius = 10;
+    int unloadRadius = 12;
+    double uploadBudget = 0.002;
+    unsigned int maxInFlight = 0;
+    float lodDistances[maxLod] = {64.0f, 112.0f, 144.0f};
+    float occluderDistance = 96.0f;
+    
+    void Update(glm::vec3 cameraPosition);
+    void ApplyEdit(const TerrainEdit& edit);
+    void Render(Shader& shader, const glm::mat4& viewProjection, glm::vec3 eye);
+    void Reset();
+    size_t MemoryBytes();
+    
+    int loadedCount = 0, pendingCount = 0;
+    int lodCounts[maxLod + 1] = {};
+    int drawnCount = 0, culledCount = 0;
+    OcclusionStats occlusionStats;
+    double lastEditSeconds = 0.0;
+    int lastEditChunks = 0, lastEditSlabs = 0;
+private:
+    static int64_t Key(int x, int z) {
+        return ((int64_t)x << 32) ^ (uint32_t)z;
+    }
+    
+    int LodFor(glm::ivec2 coordinate, glm::vec3 cameraPosition);
+    void Schedule(glm::vec3 cameraPosition);
+    void Unload(glm::ivec2 center);
+    void UploadFinished();
+    std::unique_ptr<Terrain> TakeTerrain();
+    void Recycle(std::unique_ptr<Terrain> terrain);
+    
+    static const size_t maxSpareTerrains = 32;
+    
+    std::unordered_map<int64_t, std::shared_ptr<Chunk>> chunks;
+    std::vector<glm::ivec2> pending;
+    glm::ivec2 lastCenter = glm::ivec2(INT32_MIN);
+    
+    JobGroup generating;
+    std::mutex finishedMutex;
+    std::vector<ChunkBuild> finished, uploading;
+    std::mutex spareMutex;
+    std::vector<std::unique_ptr<Terrain>> spareTerrains;
+    std::vector<TerrainEdit> edits;
+    std::vector<const Terrain*> visible;
+    OcclusionBuffer occlusion;
+};
+
+ChunkManager chunkManager;
+
+void ChunkManager::Update(glm::vec3 cameraPosition) {
+    const int size = chunkWidth;
+    
+    glm::ivec2 center = glm::ivec2((int)floor(cameraPosition.x / size), (int)floor(cameraPosition.z / size));
+    
+    if (center != lastCenter) {
+        lastCenter = center;
+        Unload(center);
+        
+        // Everything inside the load radius that isn't loaded yet or is loaded at
+        // the wrong level of detail, nearest first.
+        pending.clear();
+        for (int x = center.x - loadRadius; x <= center.x + loadRadius; x++) {
+            for (int z = center.y - loadRadius; z <= center.y + loadRadius; z++) {
+                glm::ivec2 offset = glm::ivec2(x, z) - center;
+                if (offset.x * offset.x + offset.y * offset.y > loadRadius * loadRadius) continue;
+                
+                auto it = chunks.find(Key(x, z));
+                if (it != chunks.end()) {
+                    Chunk& chunk = *it->second;
+                    if (!chunk.uploaded || chunk.building || chunk.lod == LodFor(chunk.coordinate, cameraPosition)) continue;
+                }
+                pending.push_back(glm::ivec2(x, z));
+            }
+        }
+        std::sort(pending.begin(), pending.end(), [center](glm::ivec2 a, glm::ivec2 b) {
+            glm::ivec2 da = a - center, db = b - center;
+            return da.x * da.x + da.y * da.y > db.x * db.x + db.y * db.y;
+        });
+    }
+    
+    Schedule(cameraPosition);
+    
+    // Without worker threads nothing runs queued jobs but Wait.
+    if (jobSystem.ThreadCount() == 1) jobSystem.Wait(generating);
+    
+    UploadFinished();
+    
+    pendingCount = (int)pending.size();
+}
+
+int ChunkManager::LodFor(glm::ivec2 coordinate, glm::vec3 cameraPosition) {
+    const int size = chunkWidth;
+    
+    // Chunks span chunkWidth - 1 lattice cells of 2 units from their origin.
+    float dx = coordinate.x * size + (size - 1.0f) - cameraPosition.x;
+    float dz = coordinate.y * size + (size - 1.0f) - cameraPosition.z;
+    float distance = sqrt(dx * dx + dz * dz);
+    
+    int lod = 0;
+    while (lod < maxLod && distance > lodDistances[lod]) lod++;
+    return lod;
+}
+
+void ChunkManager::Schedule(glm::vec3 cameraPosition) {
+    unsigned int limit = maxInFlight ? maxInFlight : jobSystem.ThreadCount() * 2;
+    
+    // pending is sorted farthest first so the nearest chunk is popped off the back.
+    while (!pending.empty() && (unsigned int)generating.pending < limit) {
+        glm::ivec2 coordinate = pending.back();
+        pending.pop_back();
+        
+        std::shared_ptr<Chunk>& chunk = chunks[Key(coordinate.x, coordinate.y)];
+        if (!chunk) {
+            chunk = std::make_shared<Chunk>();
+            chunk->coordinate = coordinate;
+        }
+        chunk->building = true;
+        
+        int lod = LodFor(coordinate, cameraPosition);
+        
+        std::vector<TerrainEdit> chunkEdits;
+        for (const TerrainEdit& edit : edits) {
+            if (edit.Touches(coordinate.x, coordinate.y)) chunkEdits.push_back(edit);
+        }
+        size_t editCount = edits.size();
+        
+        jobSystem.Submit(generating, [this, chunk, lod, chunkEdits, editCount]() {
+            if (chunk->cancelled) return;
+            
+            ChunkBuild build;
+            build.chunk = chunk;
+            build.terrain = TakeTerrain();
+            build.editCount = editCount;
+            loadOrGenerateChunk(*build.terrain, chunk->coordinate.x, chunk->coordinate.y, lod, chunkEdits);
+            
+            std::lock_guard<std::mutex> lock(finishedMutex);
+            finished.push_back(std::move(build));
+        });
+    }
+}
+
+void ChunkManager::Unload(glm::ivec2 center) {
+    for (auto it = chunks.begin(); it != chunks.end();) {
+        glm::ivec2 offset = it->second->coordinate - center;
+        
+        if (offset.x * offset.x + offset.y * offset.y > unloadRadius * unloadRadius) {
+            std::shared_ptr<Chunk>& chunk = it->second;
+            chunk->cancelled = true;
+            if (chunk->uploaded) {
+                terrainBatch.Remove(*chunk->terrain);
+                loadedCount--;
+                lodCounts[chunk->lod]--;
+                Recycle(std::move(chunk->terrain));
+            }
+            it = chunks.erase(it);
+        }
+        else {
+            it++;
+        }
+    }
+}
+
+void ChunkManager::UploadFinished() {
+    std::vector<ChunkBuild>& ready = uploading;
+    {
+        std::lock_guard<std::mutex> lock(finishedMutex);
+        ready.swap(finished);
+    }
+    
+    auto start = std::chrono::steady_clock::now();
+    size_t i = 0;
+    
+    for (; i < ready.size(); i++) {
+        if (i > 0 && std::chrono::duration<double>(std::chrono::steady_clock::now() - start).count() > uploadBudget) break;
+        
+        std::shared_ptr<Chunk>& chunk = ready[i].chunk;
+        if (chunk->cancelled) {
+            Recycle(std::move(ready[i].terrain));
+            continue;
+        }
+        
+        // Edits made while the chunk was being built.
+        bool edited = false;
+        for (size_t e = ready[i].editCount; e < edits.size(); e++) {
+            if (edits[e].Touches(chunk->coordinate.x, chunk->coordinate.y)) edited |= ready[i].terrain->ApplyEdit(edits[e]);
+        }
+        if (edited) ready[i].terrain->RemeshDirty();
+        
+        terrainBatch.Add(*ready[i].terrain);
+        
+        if (chunk->uploaded) {
+            terrainBatch.Remove(*chunk->terrain);
+            lodCounts[chunk->lod]--;
+            Recycle(std::move(chunk->terrain));
+        }
+        else {
+            loadedCount++;
+        }
+        
+        chunk->terrain = std::move(ready[i].terrain);
+        chunk->lod = chunk->terrain->lod;
+        chunk->uploaded = true;
+        chunk->building = false;
+        lodCounts[chunk->lod]++;
+    }
+    
+    // Whatever didn't fit in this frame's budget goes back to the front of the queue.
+    if (i < ready.size()) {
+        std::lock_guard<std::mutex> lock(finishedMutex);
+        finished.insert(finished.begin(), std::make_move_iterator(ready.begin() + i), std::make_move_iterator(ready.end()));
+    }
+    ready.clear();
+}
+
+std::unique_ptr<Terrain> ChunkManager::TakeTerrain() {
+    {
+        std::lock_guard<std::mutex> lock(spareMutex);
+        if (!spareTerrains.empty()) {
+            std::unique_ptr<Terrain> terrain = std::move(spareTerrains.back());
+            spareTerrains.pop_back();
+            return terrain;
+        }
+    }
+    return std::make_unique<Terrain>();
+}
+
+void ChunkManager::Recycle(std::unique_ptr<Terrain> terrain) {
+    if (!terrain) return;
+    terrain->storedMesh = MeshView();
+    
+    std::lock_guard<std::mutex> lock(spareMutex);
+    if (spareTerrains.size() < maxSpareTerrains) spareTerrains.push_back(std::move(terrain));
+}
+
+void ChunkManager::ApplyEdit(const TerrainEdit& edit) {
+    auto start = std::chrono::steady_clock::now();
+    
+    edits.push_back(edit);
+    lastEditChunks = 0;
+    lastEditSlabs = 0;
+    
+    for (auto& [key, chunk] : chunks) {
+        if (!chunk->uploaded || !edit.Touches(chunk->coordinate.x, chunk->coordinate.y)) continue;
+        
+        Terrain& terrain = *chunk->terrain;
+        if (!terrain.ApplyEdit(edit)) continue;
+        
+        int remeshed = terrain.stats.slabsRemeshed;
+        terrain.RemeshDirty();
+        terrainBatch.Update(terrain);
+        
+        lastEditChunks++;
+        lastEditSlabs += terrain.stats.slabsRemeshed - remeshed;
+    }
+    
+    lastEditSeconds = std::chrono::duration<double>(std::chrono::steady_clock::now() - start).count();
+}
+
+void ChunkManager::Render(Shader& shader, const glm::mat4& viewProjection, glm::vec3 eye) {
+    {
+        PROFILE_SCOPE("cull");
+        Frustum frustum = Frustum::FromMatrix(viewProjection);
+        culledCount = 0;
+        visible.clear();
+        
+        for (auto& [key, chunk] : chunks) {
+            if (!chunk->uploaded) continue;
+            
+            if (!frustum.Intersects(chunk->terrain->bounds)) {
+                culledCount++;
+                continue;
+            }
+            visible.push_back(chunk->terrain.get());
+        }
+    }
+    
+    if (occlusionCulling) {
+        PROFILE_SCOPE("occlusion");
+        occlusionStats = cullOccluded(occlusion, viewProjection, eye, occluderDistance, visible);
+    }
+    else occlusionStats = OcclusionStats();
+    
+    drawnCount = (int)visible.size();
+    terrainBatch.Draw(shader, visible);
+}
+
+size_t ChunkManager::MemoryBytes() {
+    size_t bytes = 0;
+    for (auto& [key, chunk] : chunks) {
+        if (chunk->uploaded) bytes += chunk->terrain->MemoryBytes();
+    }
+    return bytes;
+}
+
+void ChunkManager::Reset() {
+    for (auto& [key, chunk] : chunks) {
+        chunk->cancelled = true;
+    }
+    
+    // Queued jobs return straight away once cancelled; running ones are short.
+    jobSystem.Wait(generating);
+    
+    for (auto& [key, chunk] : chunks) {
+        if (chunk->uploaded) terrainBatch.Remove(*chunk->terrain);
+    }
+    chunks.clear();
+    finished.clear();
+    pending.clear();
+    edits.clear();
+    lastCenter = glm::ivec2(INT32_MIN);
+    loadedCount = 0;
+    std::fill(std::begin(lodCounts), std::end(lodCounts), 0);
+}
+
+#endif /* chunkManager_h */
@@ -16,11 +16,13 @@ public:
     void SetVector3(const char* variableName, glm::vec3 vec);
     void SetVector2(const char *variableName, glm::vec2 vec);
     void SetInt(const char* variableName, int value);
+    int UniformLocation(const char* variableName);
 private:
     static void CompileShader(int shader, const char* source);
     static void PrintShaderLog(int shader);
     static int LoadShaderSource(const char* shaderPath, int shaderType);
     uint32_t program;
+    std::unordered_map<std::string, int> uniformLocations;
 };
 
 Shader Shader::Create(const char* shaderFolderPath) {
@@ -89,22 +91,32 @@ void Shader::Use() {
     glUseProgram(program);
 }
 
-void Shader::SetMatrix4(const char* variableName, glm::mat4& mat) {
+// glGetUniformLocation is looked up once per name and cached.
+int Shader::UniformLocation(const char* variableName) {
+    auto found = uniformLocations.find(variableName);
+    if (found != uniformLocations.end()) return found->second;
+    
     int location = glGetUniformLocation(program, variableName);
+    uniformLocations[variableName] = location;
+    return location;
+}
+
+void Shader::SetMatrix4(const char* variableName, glm::mat4& mat) {
+    int location = UniformLocation(variableName);
     glUniformMatrix4fv(location, 1, GL_FALSE, &mat[0][0]);
 }
 
 void Shader::SetVector3(const char* variableName, glm::vec3 vec) {
-    int location = glGetUniformLocation(program, variableName);
+    int location = UniformLocation(variableName);
     glUniform3fv(location, 1, &vec[0]);
 }
 void Shader::SetVector2(const char *variableName, glm::vec2 vec) {
-    int location = glGetUniformLocation(program, variableName);
+    int location = UniformLocation(variableName);
     glUniform2fv(location, 1, &vec[0]);
 }
 
 void Shader::SetInt(const char *variableName, int value) {
-    int location = glGetUniformLocation(program, variableName);
+    int location = UniformLocation(variableName);
     glUniform1i(location, value);
 }
 
@@ -0,0 +1,137 @@
+//
+//  stagingRing.h
+//  Marching Cube Terrain
+//
+//  Created by Dmitri Wamback on 2026-10-16.
+//
+
+#ifndef stagingRing_h
+#define stagingRing_h
+
+#include <deque>
+#include <cstring>
+
+// Mesh uploads are written into a persistently mapped ring and copied into
+// their destination buffer on the GPU, so glBufferSubData never has to wait
+// for a draw still reading the target. Each frame's writes are closed with a
+// fence; space is only reused once the GPU has passed it. Without buffer
+// storage (GL < 4.4, e.g. macOS) Copy falls back to glBufferSubData.
+class StagingRing {
+public:
+    bool persistent = false;
+    size_t uploadedBytes = 0;
+    int stalls = 0;
+    
+    void Initialize(size_t capacity);
+    void Copy(uint32_t destination, size_t destinationOffset, const void* data, size_t bytes);
+    void Fence();
+    void Release();
+private:
+    struct InFlight {
+        GLsync sync;
+        size_t bytes;
+    };
+    
+    void WaitOldest();
+    
+    uint32_t buffer = 0;
+    uint8_t* mapped = nullptr;
+    size_t capacity = 0, head = 0, used = 0, unfenced = 0;
+    std::deque<InFlight> inFlight;
+};
+
+void StagingRing::Initialize(size_t capacity) {
+    Release();
+    
+    persistent = GLEW_VERSION_4_4 || GLEW_ARB_buffer_storage;
+    if (!persistent) return;
+    capacity &= ~(size_t)15;
+    
+    GLbitfield flags = GL_MAP_WRITE_BIT | GL_MAP_PERSISTENT_BIT | GL_MAP_COHERENT_BIT;
+    
+    glGenBuffers(1, &buffer);
+    glBindBuffer(GL_COPY_READ_BUFFER, buffer);
+    glBufferStorage(GL_COPY_READ_BUFFER, capacity, nullptr, flags);
+    mapped = (uint8_t*)glMapBufferRange(GL_COPY_READ_BUFFER, 0, capacity, flags);
+    
+    if (!mapped) {
+        glDeleteBuffers(1, &buffer);
+        buffer = 0;
+        persistent = false;
+        return;
+    }
+    this->capacity = capacity;
+}
+
+void StagingRing::Copy(uint32_t destination, size_t destinationOffset, const void* data, size_t bytes) {
+    if (!bytes) return;
+    uploadedBytes += bytes;
+    PROFILE_COUNT(BytesUploaded, bytes);
+    
+    if (!persistent || bytes > capacity) {
+        glBindBuffer(GL_COPY_WRITE_BUFFER, destination);
+        glBufferSubData(GL_COPY_WRITE_BUFFER, destinationOffset, bytes, data);
+        return;
+    }
+    
+    // The tail of the ring is skipped rather than split across the wrap.
+    size_t padding;
+    while (true) {
+        padding = head + bytes > capacity ? capacity - head : 0;
+        if (used + padding + bytes <= capacity) break;
+        
+        if (!inFlight.empty()) WaitOldest();
+        else if (unfenced) Fence();
+        else head = 0;
+    }
+    size_t needed = padding + bytes;
+    
+    if (padding) head = 0;
+    size_t offset = head;
+    
+    std::memcpy(mapped + offset, data, bytes);
+    head = (offset + bytes + 15) & ~(size_t)15;
+    needed += head - offset - bytes;
+    
+    used += needed;
+    unfenced += needed;
+    
+    glBindBuffer(GL_COPY_READ_BUFFER, buffer);
+    glBindBuffer(GL_COPY_WRITE_BUFFER, destination);
+    glCopyBufferSubData(GL_COPY_READ_BUFFER, GL_COPY_WRITE_BUFFER, offset, destinationOffset, bytes);
+}
+
+void StagingRing::Fence() {
+    if (!unfenced) return;
+    inFlight.push_back({glFenceSync(GL_SYNC_GPU_COMMANDS_COMPLETE, 0), unfenced});
+    unfenced = 0;
+}
+
+void StagingRing::WaitOldest() {
+    InFlight oldest = inFlight.front();
+    inFlight.pop_front();
+    
+    GLenum status = glClientWaitSync(oldest.sync, 0, 0);
+    if (status == GL_TIMEOUT_EXPIRED) {
+        stalls++;
+        while (glClientWaitSync(oldest.sync, GL_SYNC_FLUSH_COMMANDS_BIT, 1000000) == GL_TIMEOUT_EXPIRED);
+    }
+    glDeleteSync(oldest.sync);
+    used -= oldest.bytes;
+}
+
+void StagingRing::Release() {
+    Fence();
+    while (!inFlight.empty()) WaitOldest();
+    
+    if (buffer) {
+        glBindBuffer(GL_COPY_READ_BUFFER, buffer);
+        glUnmapBuffer(GL_COPY_READ_BUFFER);
+        glDeleteBuffers(1, &buffer);
+    }
+    buffer = 0;
+    mapped = nullptr;
+    capacity = head = used = unfenced = 0;
+}
+
+#endif /* stagingRing_h */
@@ -8,20 +8,378 @@
 #ifndef terrain_h
 #define terrain_h
 
-#include <thread>
+class Shader;
 
+// Flat emits three vertices per triangle with face normals; Indexed welds
+// vertices on shared cube edges and uses density-gradient normals.
+enum class MeshMode {
+    Flat,
+    Indexed
+};
+
+MeshMode meshMode = MeshMode::Indexed;
+
+// The mesher skips 4x4x4-cube bricks whose density range lies entirely on one
+// side of the isolevel; the min/max per brick is gathered while sampling.
+bool brickSkipping = true;
+
+// Cubes are classified from per-row sign bitmasks, so each density point is
+// compared against the isolevel once instead of by all eight cubes sharing it.
+// Off falls back to reading the eight corners per cube (kept for --mesh-bench).
+bool signMasks = true;
+
+// Each chunk's marching is split into x ranges, one per idle job system
+// thread, that are meshed at the same time and merged in order (see
+// Terrain::BuildMeshParts), so the mesh is the same on any thread count.
+bool parallelMeshing = true;
+
+// Cave octaves stop once every voxel of a row is decided to be on one side of
+// the isolevel (DensityProgram::EvaluateRowsBounded); the culled rows the
+// mesher reads values from are then redone in full, so meshes don't change.
+// Elsewhere only the sign of the density is exact.
+bool octaveCulling = true;
+
+const int brickSize = 4;
+const int bricksXZ = (chunkWidth - 1 + brickSize - 1) / brickSize;
+const int bricksY = (chunkHeight - 1 + brickSize - 1) / brickSize;
+
+// Level of detail: a chunk at lod n samples and meshes every (1 << n)th lattice
+// point. Coarse chunks hang skirts of lodSkirtDepth strides below their side
+// edges, which covers the cracks where they meet finer neighbours.
+const int maxLod = 3;
+float lodSkirtDepth = 2.0f;
+
+// Constants of the density function. Anything that changes the generated
+// terrain belongs here so caches can tell worlds apart by Hash().
+struct TerrainParameters {
+    float frequency = 0.025f;
+    float lacunarity = 1.5f;
+    float persistence = 0.6f;
+    float heightScale = 102.0f;
+    int mountainOctaves = 10;
+    
+    float plateauScale = 0.2f;
+    double plateauLacunarity = 1.2;
+    double plateauPersistence = 0.2;
+    int plateauOctaves = 3;
+    float plateauHeight = 5.0f;
+    float plateauOffset = 5.0f;
+    
+    float caveFreq = 10.0f;
+    int caveOctaves = 10;
+    float caveStrength = 10.0f;
+    int floorHeight = 4;
+    
+    uint64_t Hash() const;
+    bool Set(const std::string& key, const std::string& value);
+    bool Load(const std::string& path, bool* seedSet = nullptr);
+    std::string DensityGraph() const;
+};
+
+TerrainParameters terrainParameters;
+
+uint64_t TerrainParameters::Hash() const {
+    uint64_t hash = fnvOffset;
+    hash = fnv1a(frequency, hash);
+    hash = fnv1a(lacunarity, hash);
+    hash = fnv1a(persistence, hash);
+    hash = fnv1a(heightScale, hash);
+    hash = fnv1a(mountainOctaves, hash);
+    hash = fnv1a(plateauScale, hash);
+    hash = fnv1a(plateauLacunarity, hash);
+    hash = fnv1a(plateauPersistence, hash);
+    hash = fnv1a(plateauOctaves, hash);
+    hash = fnv1a(plateauHeight, hash);
+    hash = fnv1a(plateauOffset, hash);
+    hash = fnv1a(caveFreq, hash);
+    hash = fnv1a(caveOctaves, hash);
+    hash = fnv1a(caveStrength, hash);
+    hash = fnv1a(floorHeight, hash);
+    return hash;
+}
+
+// Sets a parameter (or the world seed) by name, for --param and config files.
+bool TerrainParameters::Set(const std::string& key, const std::string& value) {
+    std::pair<const char*, float*> floats[] = {
+        {"frequency", &frequency}, {"lacunarity", &lacunarity}, {"persistence", &persistence}, {"heightScale", &heightScale},
+        {"plateauScale", &plateauScale}, {"plateauHeight", &plateauHeight}, {"plateauOffset", &plateauOffset},
+        {"caveFreq", &caveFreq}, {"caveStrength", &caveStrength}, {"seed", &seed}
+    };
+    std::pair<const char*, int*> ints[] = {
+        {"mountainOctaves", &mountainOctaves}, {"plateauOctaves", &plateauOctaves}, {"caveOctaves", &caveOctaves}, {"floorHeight", &floorHeight}
+    };
+    std::pair<const char*, double*> doubles[] = {
+        {"plateauLacunarity", &plateauLacunarity}, {"plateauPersistence", &plateauPersistence}
+    };
+    
+    try {
+        for (auto& [name, field] : floats) if (key == name) { *field = std::stof(value); return true; }
+        for (auto& [name, field] : ints) if (key == name) { *field = std::stoi(value); return true; }
+        for (auto& [name, field] : doubles) if (key == name) { *field = std::stod(value); return true; }
+    }
+    catch (const std::exception&) {}
+    return false;
+}
+
+// One "key = value" per line; '#' starts a comment. seedSet, if given, tells
+// whether the file set the seed.
+bool TerrainParameters::Load(const std::string& path, bool* seedSet) {
+    std::ifstream file(path);
+    if (!file) return false;
+    
+    auto trim = [](const std::string& text) {
+        size_t first = text.find_first_not_of(" \t\r");
+        size_t last = text.find_last_not_of(" \t\r");
+        return first == std::string::npos ? std::string() : text.substr(first, last - first + 1);
+    };
+    
+    std::string line;
+    int lineNumber = 0;
+    if (seedSet) *seedSet = false;
+    
+    while (std::getline(file, line)) {
+        lineNumber++;
+        line = line.substr(0, line.find('#'));
+        
+        size_t equals = line.find('=');
+        if (trim(line).empty()) continue;
+        if (equals == std::string::npos || !Set(trim(line.substr(0, equals)), trim(line.substr(equals + 1)))) {
+            std::cout << path << ":" << lineNumber << ": unknown setting '" << trim(line) << "'\n";
+            return false;
+        }
+        if (seedSet && trim(line.substr(0, equals)) == "seed") *seedSet = true;
+    }
+    return true;
+}
+
+// The built-in density function written as a graph (see densityGraph.h), at
+// full precision so it compiles back to exactly these constants.
+std::string TerrainParameters::DensityGraph() const {
+    std::ostringstream graph;
+    graph << std::setprecision(17);
+    graph << "mountain = fbm2 1 " << lacunarity << " " << persistence << " " << mountainOctaves << "\n"
+          << "plateau = fbm2 " << plateauScale << " " << plateauLacunarity << " " << plateauPersistence << " " << plateauOctaves << "\n"
+          << "peaks = mul mountain " << heightScale << "\n"
+          << "shelf = mul plateau " << plateauHeight << "\n"
+          << "shelfOffset = add shelf " << plateauOffset << "\n"
+          << "height = add peaks shelfOffset\n"
+          << "cave = fbm3 " << caveFreq << " " << lacunarity << " " << persistence << " " << caveOctaves << "\n"
+          << "caveClamped = clamp cave 0 cave\n"
+          << "surface = sub y height\n"
+          << "carve = mul caveClamped " << caveStrength << "\n"
+          << "solid = add surface carve\n"
+          << "density = floor solid " << floorHeight << " -1\n";
+    return graph.str();
+}
+
+// The program SampleDensity runs: the --graph one if loaded, otherwise the
+// built-in graph, compiled once per parameter set. Chunks share it rather
+// than copying its code. A parameter set that doesn't compile returns null
+// with the reason in error, or aborts if no error is asked for; main and bake
+// check the parameters up front so chunk jobs never see one.
+std::shared_ptr<const DensityProgram> densityProgram(const TerrainParameters& parameters, std::string* error = nullptr) {
+    static std::mutex mutex;
+    static uint64_t compiledHash = 0;
+    static std::shared_ptr<const DensityProgram> compiled;
+    
+    std::lock_guard<std::mutex> lock(mutex);
+    uint64_t hash = densityGraph.Empty() ? parameters.Hash() : fnv1a(densityGraph.Hash(), fnvOffset);
+    if (!compiled || hash != compiledHash) {
+        std::shared_ptr<DensityProgram> program = std::make_shared<DensityProgram>();
+        std::string message;
+        if (!densityGraph.Empty()) {
+            *program = densityGraph;
+        }
+        else if (!DensityProgram::Compile(parameters.DensityGraph(), *program, message)) {
+            if (error) {
+                *error = "terrain parameters don't compile: " + message;
+                return nullptr;
+            }
+            std::cout << "terrain parameters don't compile: " << message << '\n';
+            std::abort();
+        }
+        
+        compiled = program;
+        compiledHash = hash;
+    }
+    return compiled;
+}
+
+// Seed, parameters and (if one is loaded) the graph: everything the density
+// field depends on.
+uint64_t worldFingerprint(const TerrainParameters& parameters = terrainParameters) {
+    uint64_t hash = fnv1a(seed, parameters.Hash());
+    return densityGraph.Empty() ? hash : fnv1a(densityGraph.Hash(), hash);
+}
+
+// Dig carves the shape out of the terrain, Fill adds it. Positions and sizes
+// are in world units; a sphere uses radius, a box halfExtents.
+enum class EditShape {
+    Sphere,
+    Box
+};
+
+enum class EditOperation {
+    Dig,
+    Fill
+};
+
+struct TerrainEdit {
+    EditShape shape = EditShape::Sphere;
+    EditOperation operation = EditOperation::Dig;
+    glm::vec3 center = glm::vec3(0.0f);
+    float radius = 1.0f;
+    glm::vec3 halfExtents = glm::vec3(1.0f);
+    
+    glm::vec3 Min() const;
+    glm::vec3 Max() const;
+    float SignedDistance(glm::vec3 point) const;
+    bool Touches(int chunkX, int chunkZ) const;
+};
+
+glm::vec3 TerrainEdit::Min() const {
+    return shape == EditShape::Sphere ? center - glm::vec3(radius) : center - halfExtents;
+}
+
+glm::vec3 TerrainEdit::Max() const {
+    return shape == EditShape::Sphere ? center + glm::vec3(radius) : center + halfExtents;
+}
+
+float TerrainEdit::SignedDistance(glm::vec3 point) const {
+    glm::vec3 offset = point - center;
+    if (shape == EditShape::Sphere) return glm::length(offset) - radius;
+    
+    glm::vec3 q = glm::vec3(fabs(offset.x), fabs(offset.y), fabs(offset.z)) - halfExtents;
+    glm::vec3 outside = glm::vec3(std::max(q.x, 0.0f), std::max(q.y, 0.0f), std::max(q.z, 0.0f));
+    return glm::length(outside) + std::min(std::max(q.x, std::max(q.y, q.z)), 0.0f);
+}
+
+// Chunks cover chunkWidth lattice columns 2 units apart from
+// (x * chunkWidth, -10, z * chunkWidth).
+bool TerrainEdit::Touches(int chunkX, int chunkZ) const {
+    const float span = (chunkWidth - 1) * 2.0f;
+    glm::vec3 low = Min(), high = Max();
+    return high.x >= chunkX * chunkWidth && low.x <= chunkX * chunkWidth + span &&
+           high.z >= chunkZ * chunkWidth && low.z <= chunkZ * chunkWidth + span &&
+           high.y >= -10.0f && low.y <= chunkHeight - 11.0f;
+}
+
+// An edited chunk keeps its mesh in one section per slab of x cubes, each
+// with spare room, so an edit only remeshes and re-uploads the slabs it
+// touched. Indices are absolute, so a slab that still fits doesn't move.
+struct MeshSlab {
+    uint32_t vertexStart = 0, vertexCount = 0, vertexCapacity = 0;
+    uint32_t indexStart = 0, indexCount = 0, indexCapacity = 0;
+    AABB bounds;
+    bool dirty = true;
+    bool stale = true;
+};
+
+// Vertices and indices a mesh pass will emit (see Terrain::CountMesh).
+struct MeshCount {
+    size_t vertices = 0, indices = 0;
+};
+
+// Cubes one mesher pass visited and skipped, kept per pass so passes over
+// different x ranges of a chunk can run at once.
+struct CubeCount {
+    int visited = 0, skipped = 0;
+};
+
+struct GenerationStats {
+    double densitySeconds = 0.0, meshSeconds = 0.0;
+    int bricksSkipped = 0, bricksTotal = 0;
+    int cubesVisited = 0, cubesSkipped = 0;
+    int slabsRemeshed = 0;
+    int64_t voxelsSampled = 0, octavesSampled = 0;
+    int rowsRefined = 0;
+    int sectionsStored = 0;
+    MeshCount meshCounted;
+};
+
+// Read-only view of a chunk mesh, either over Terrain's own vectors or over a
+// memory-mapped chunk store record (owner keeps the mapping alive).
+struct MeshView {
+    const void* vertices = nullptr;
+    size_t vertexCount = 0;
+    bool packed = false;
+    const uint32_t* indices = nullptr;
+    size_t indexCount = 0;
+    std::shared_ptr<const void> owner;
+    
+    size_t VertexBytes() const {
+        return vertexCount * (packed ? sizeof(PackedVertex) : sizeof(Vertex));
+    }
+};
+
+// Move-only: a chunk's fields are large and owned by one place at a time, and
+// ChunkManager recycles unloaded terrains instead of freeing them.
 class Terrain {
 public:
-    std::array<float, 16 * 256 * 16> density;
+    Terrain() = default;
+    Terrain(const Terrain&) = delete;
+    Terrain& operator=(const Terrain&) = delete;
+    Terrain(Terrain&&) = default;
+    Terrain& operator=(Terrain&&) = default;
+    
+    DensityField density;
+    std::vector<uint8_t> culledRows;
+    PackedDensity packedDensity;
     std::vector<Vertex> vertices;
+    std::vector<PackedVertex> packedVertices;
+    std::vector<uint32_t> indices;
+    MeshView storedMesh;
+    std::vector<MeshSlab> slabs;
+    std::vector<OccluderBox> occluders;
+    std::vector<TerrainEdit> appliedEdits;
+    bool layoutChanged = false;
+    std::array<float, bricksXZ * bricksY * bricksXZ> brickMin, brickMax;
     glm::vec3 position, scale, rotation;
+    AABB bounds;
+    int chunkX = 0, chunkZ = 0;
+    int lod = 0;
+    GenerationStats stats;
     
     static Terrain CreateTerrain(int xOffset, int yOffset);
-    void Render(Shader shader);
-    void Generate(int xOffset, int yOffset);
+    void Generate(int xOffset, int yOffset, int lod = 0, const std::vector<TerrainEdit>& edits = {});
+    void Place(int xOffset, int yOffset);
+    void SampleDensity(int xOffset, int yOffset);
+    int RefineBox(glm::ivec3 low, glm::ivec3 high);
+    void BuildMesh();
+    MeshCount CountMesh(int xBegin, int xEnd);
+    void RetainDensity();
+    bool EnsureDensity();
+    void ComputeBrickRanges(glm::ivec3 low = glm::ivec3(0), glm::ivec3 high = glm::ivec3(chunkWidth - 1, chunkHeight - 1, chunkWidth - 1));
+    bool ApplyEdit(const TerrainEdit& edit);
+    void RemeshDirty();
+    void BuildOccluders();
+    AABB OccluderBounds(const OccluderBox& box) const;
+    size_t MemoryBytes() const;
+    MeshView Mesh() const;
+    size_t VertexCount() const;
+    size_t TriangleCount() const;
+    uint64_t MeshHash() const;
+    uint64_t TriangleHash() const;
+    uint64_t DensityHash() const;
     glm::mat4 CreateModelMatrix();
 private:
-    uint32_t vertexArrayObject, vertexBufferObject, indexBufferObject;
+    void SampleColumns(const DensityProgram& program, uint64_t fingerprint, std::vector<float>& columns);
+    void RefineRow(const DensityProgram& program, const std::vector<float>& columns, int x, int y, int tz);
+    int RefineSurface(const DensityProgram& program, const std::vector<float>& columns);
+    void CompactSections();
+    bool BuildMeshParts(int parts, int extent, std::vector<Vertex>& meshVertices, CubeCount& cubes);
+    void BuildFlatMesh(int xBegin, int xEnd, std::vector<Vertex>& meshVertices, CubeCount& cubes);
+    void BuildIndexedMesh(int xBegin, int xEnd, std::vector<Vertex>& meshVertices, std::vector<uint32_t>& meshIndices,
+                          CubeCount& cubes, bool continued = false, uint32_t* lastPlane = nullptr);
+    int ClassifyCube(int x, int y, int z, int stride, float cubeValues[8], glm::vec3 cubePositions[8]);
+    void ClassifyPlane(int x, int stride, RowMask signs[chunkHeight]);
+    void CubeCorners(int x, int y, int z, int stride, float cubeValues[8], glm::vec3 cubePositions[8]);
+    glm::vec3 DensityGradient(int x, int y, int z, int stride);
+    bool BrickActive(int bx, int by, int bz);
+    bool RegionActive(int x, int y, int z, int span, int spanZ);
+    int SkipInactive(int x, int y, int z);
+    void AddSkirts(std::vector<Vertex>& meshVertices, std::vector<uint32_t>& meshIndices);
+    int SlabWidth() const;
 };
 
 Terrain Terrain::CreateTerrain(int xOffset, int yOffset) {
@@ -31,128 +389,1187 @@ Terrain Terrain::CreateTerrain(int xOffset, int yOffset) {
     return terrain;
 }
 
-void Terrain::Render(Shader shader) {
-    shader.Use();
+inline int brickIndex(int bx, int by, int bz) {
+    return (bx * bricksY + by) * bricksXZ + bz;
+}
+
+// Last lattice index a mesher at this stride reaches along an axis of n points.
+inline int lodExtent(int n, int stride) {
+    return (n - 1) / stride * stride;
+}
+
+// One block of z rows through column tile tz at lattice column x, from height
+// y up, in the form DensityProgram evaluates.
+struct DensityRowBlock {
+    float y[DensityProgram::maxRows], height[DensityProgram::maxRows];
+    float z[DensityTile::size];
+    float columns[DensityProgram::maxRegisters * DensityProgram::maxLanes];
+    DensityRows rows;
+    
+    void Set(const DensityProgram& program, const std::vector<float>& chunkColumns, float frequency,
+             int chunkX, int chunkZ, int x, int y, int tz, int stride, int maxRows) {
+        const int size = chunkWidth;
+        const int tileSize = DensityTile::size;
+        int count = 0;
+        
+        for (int z = tz * tileSize; z < (tz + 1) * tileSize; z += stride) {
+            this->z[count] = (float)(z + seed + chunkZ*tileSize) * frequency / noiseColumnScale;
+            for (int c = 0; c < program.Channels(); c++) {
+                columns[c * DensityProgram::maxLanes + count] = chunkColumns[c * size * size + x * size + z];
+            }
+            count++;
+        }
         
-    glm::mat4 model = CreateModelMatrix();
+        rows.rows = std::min(maxRows, (chunkHeight - y + stride - 1) / stride);
+        for (int r = 0; r < rows.rows; r++) {
+            this->y[r] = (float)(y + r * stride) * frequency / noiseColumnScale;
+            height[r] = (float)(y + r * stride);
+        }
         
-    glBindVertexArray(vertexArrayObject);
-    shader.SetMatrix4("model", model);
+        rows.x = (float)(x + seed + chunkX*tileSize) * frequency / noiseColumnScale;
+        rows.y = this->y;
+        rows.height = height;
+        rows.z = this->z;
+        rows.columns = columns;
+        rows.count = count;
+    }
+};
+
+void Terrain::Generate(int xOffset, int yOffset, int lod, const std::vector<TerrainEdit>& edits) {
+    stats = GenerationStats();
+    packedDensity.Reset();
+    appliedEdits.clear();
+    layoutChanged = false;
+    this->lod = lod;
+    Place(xOffset, yOffset);
+    
+    auto start = std::chrono::steady_clock::now();
+    SampleDensity(xOffset, yOffset);
+    for (const TerrainEdit& edit : edits) ApplyEdit(edit);
+    
+    auto sampled = std::chrono::steady_clock::now();
+    BuildMesh();
     
-    glDrawArrays(GL_TRIANGLES, 0, vertices.size());
-    glBindVertexArray(0);
+    stats.densitySeconds = std::chrono::duration<double>(sampled - start).count();
+    stats.meshSeconds = std::chrono::duration<double>(std::chrono::steady_clock::now() - sampled).count();
+    
+    RetainDensity();
 }
 
-inline int index3D(int x, int y, int z) {
-    return x * 256 * 16 + y * 16 + z;
+void Terrain::Place(int xOffset, int yOffset) {
+    const int size = chunkWidth;
+    
+    chunkX = xOffset;
+    chunkZ = yOffset;
+    
+    scale = glm::vec3(1.0f);
+    rotation = glm::vec3(0.0f);
+    position = glm::vec3(xOffset * size, -10.0f, yOffset * size);
 }
 
-void Terrain::Generate(int xOffset, int yOffset) {
-    const int size = 16;
+void Terrain::SampleDensity(int xOffset, int yOffset) {
+    PROFILE_CHUNK("density", xOffset, yOffset);
+    const int stride = 1 << lod;
     const float isolevel = 0.0f;
+    const TerrainParameters parameters = terrainParameters;
+    const std::shared_ptr<const DensityProgram> compiled = densityProgram(parameters);
+    const DensityProgram& program = *compiled;
+    const bool bounded = octaveCulling;
+    
+    uint64_t fingerprint = worldFingerprint(parameters);
+    
+    density.Allocate();
+    culledRows.assign(bounded ? chunkWidth * chunkHeight * 2 : 0, 0);
+    
+    ScratchLease scratch;
+    std::vector<float>& columns = scratch->columns;
+    SampleColumns(program, fingerprint, columns);
+    
+    // Each column quarter of the chunk is a density tile shared with the
+    // three other chunks overlapping it, so only tiles no neighbour has
+    // produced yet run the cave noise. One job per tile.
+    JobGroup tiles;
+    std::atomic<int64_t> voxels{0}, octaves{0};
+    
+    for (int tx = 0; tx < 2; tx++) {
+        for (int tz = 0; tz < 2; tz++) {
+            jobSystem.Submit(tiles, [&, tx, tz]() {
+                const int tileSize = DensityTile::size;
+                
+                std::shared_ptr<const DensityTile> tile = densityTileCache.Get(xOffset + tx, yOffset + tz, lod, fnv1a(bounded, fingerprint), [&](DensityTile& fresh) {
+                    fresh.Resize(lod);
+                    
+                    DensityRowBlock block;
+                    float rowDensity[DensityProgram::blockLanes];
+                    bool culled[DensityProgram::maxRows] = {};
+                    int64_t tileVoxels = 0, tileOctaves = 0;
+                    
+                    for (int x = tx * tileSize; x < (tx + 1) * tileSize; x += stride) {
+                        for (int y = 0; y < chunkHeight; y += stride * DensityProgram::maxRows) {
+                            block.Set(program, columns, parameters.frequency, xOffset, yOffset, x, y, tz, stride, DensityProgram::maxRows);
+                            const DensityRows& rows = block.rows;
+                            
+                            if (bounded) {
+                                tileOctaves += program.EvaluateRowsBounded(rows, isolevel, rowDensity, culled);
+                            }
+                            else {
+                                program.EvaluateRows(rows, rowDensity);
+                                tileOctaves += program.VoxelOctaves() * rows.count * rows.rows;
+                            }
+                            tileVoxels += rows.count * rows.rows;
+                            
+                            for (int r = 0; r < rows.rows; r++) {
+                                for (int i = 0; i < rows.count; ++i) {
+                                    fresh.At(x - tx * tileSize, y + r * stride, i * stride) = rowDensity[r * rows.count + i];
+                                }
+                                if (culled[r]) fresh.Culled(x - tx * tileSize, y + r * stride) = 1;
+                            }
+                        }
+                    }
+                    voxels += tileVoxels;
+                    octaves += tileOctaves;
+                });
+                
+                for (int x = 0; x < tileSize; x += stride) {
+                    for (int y = 0; y < chunkHeight; y += stride) {
+                        float* row = density.WritableRow(tx * tileSize + x, y) + tz * tileSize;
+                        for (int z = 0; z < tileSize; z += stride) row[z] = tile->At(x, y, z);
+                        if (bounded) culledRows[((tx * tileSize + x) * chunkHeight + y) * 2 + tz] = tile->Culled(x, y);
+                    }
+                }
+            });
+        }
+    }
+    
+    jobSystem.Wait(tiles);
+    
+    stats.voxelsSampled = voxels;
+    stats.octavesSampled = octaves;
+    if (bounded) stats.rowsRefined = RefineSurface(program, columns);
+    
+    CompactSections();
+    ComputeBrickRanges();
+}
 
-    const float frequency = 0.025f;
-    const float lacunarity = 1.5f;
-    const float persistence = 0.6f;
-    const float heightScale = 102.0f;
-    const float caveFreq = 10.0f;
+// The graph's column channels over the whole chunk (the surface height, for
+// the built-in graph), channel by channel in x, z order, from the heightfield
+// tiles.
+void Terrain::SampleColumns(const DensityProgram& program, uint64_t fingerprint, std::vector<float>& columns) {
+    const int size = chunkWidth;
+    const int channels = program.Channels();
+    const float frequency = terrainParameters.frequency;
+    const int tileArea = HeightfieldTile::size * HeightfieldTile::size;
     
-    vertices = {};
+    columns.resize(channels * size * size);
     
-    unsigned int numThreads = std::thread::hardware_concurrency();
-    if (numThreads == 0) numThreads = 4;
+    for (int tx = 0; tx < 2; tx++) {
+        for (int tz = 0; tz < 2; tz++) {
+            int tileX = chunkX + tx;
+            int tileZ = chunkZ + tz;
+            
+            std::shared_ptr<const HeightfieldTile> tile = heightfieldCache.Get(tileX, tileZ, 0, fingerprint, [&](HeightfieldTile& fresh) {
+                fresh.channels.resize(channels * tileArea);
+                float column[DensityProgram::maxRegisters];
+                
+                for (int x = 0; x < HeightfieldTile::size; x++) {
+                    for (int z = 0; z < HeightfieldTile::size; z++) {
+                        
+                        float xi = (float)(x + seed + tileX*HeightfieldTile::size) * frequency / noiseColumnScale;
+                        float zi = (float)(z + seed + tileZ*HeightfieldTile::size) * frequency / noiseColumnScale;
+                        
+                        program.EvaluateColumn(xi, zi, column);
+                        for (int c = 0; c < channels; c++) {
+                            fresh.channels[c * tileArea + x * HeightfieldTile::size + z] = column[c];
+                        }
+                    }
+                }
+            });
+            
+            for (int c = 0; c < channels; c++) {
+                for (int x = 0; x < HeightfieldTile::size; x++) {
+                    for (int z = 0; z < HeightfieldTile::size; z++) {
+                        columns[c * size * size + (tx * HeightfieldTile::size + x) * size + tz * HeightfieldTile::size + z] =
+                            tile->channels[c * tileArea + x * HeightfieldTile::size + z];
+                    }
+                }
+            }
+        }
+    }
+}
+
+// Evaluates the z row at (x, y) through column tile tz in full.
+void Terrain::RefineRow(const DensityProgram& program, const std::vector<float>& columns, int x, int y, int tz) {
+    const int stride = 1 << lod;
+    
+    DensityRowBlock block;
+    float rowDensity[DensityProgram::maxLanes];
+    block.Set(program, columns, terrainParameters.frequency, chunkX, chunkZ, x, y, tz, stride, 1);
+    program.EvaluateRows(block.rows, rowDensity);
+    
+    float* row = density.WritableRow(x, y) + tz * DensityTile::size;
+    for (int i = 0; i < block.rows.count; i++) row[i * stride] = rowDensity[i];
+    if (!culledRows.empty()) culledRows[(x * chunkHeight + y) * 2 + tz] = 0;
+    stats.octavesSampled += program.VoxelOctaves() * block.rows.count;
+}
+
+// Redoes the culled rows the mesher reads values from: points whose sign
+// differs from a lattice neighbour's are interpolated between, and their
+// neighbours feed the central-difference normals. Returns the rows redone.
+int Terrain::RefineSurface(const DensityProgram& program, const std::vector<float>& columns) {
+    const int stride = 1 << lod;
+    const float isolevel = 0.0f;
+    const int extent = lodExtent(chunkWidth, stride);
+    const int extentY = lodExtent(chunkHeight, stride);
+    
+    uint64_t lattice = 0;
+    for (int z = 0; z <= extent; z += stride) lattice |= (uint64_t)1 << z;
+    uint64_t pairs = lattice & (lattice >> stride);
+    
+    static thread_local RowMask signs[chunkWidth][chunkHeight], surface[chunkWidth][chunkHeight];
+    
+    for (int x = 0; x <= extent; x += stride) {
+        for (int y = 0; y <= extentY; y += stride) {
+            signs[x][y] = rowSigns(density.Row(x, y), isolevel) & lattice;
+            surface[x][y] = 0;
+        }
+    }
+    
+    for (int x = 0; x <= extent; x += stride) {
+        for (int y = 0; y <= extentY; y += stride) {
+            uint64_t alongZ = (signs[x][y] ^ (signs[x][y] >> stride)) & pairs;
+            surface[x][y] |= alongZ | alongZ << stride;
+            
+            if (y + stride <= extentY) {
+                RowMask alongY = signs[x][y] ^ signs[x][y + stride];
+                surface[x][y] |= alongY;
+                surface[x][y + stride] |= alongY;
+            }
+            if (x + stride <= extent) {
+                RowMask alongX = signs[x][y] ^ signs[x + stride][y];
+                surface[x][y] |= alongX;
+                surface[x + stride][y] |= alongX;
+            }
+        }
+    }
+    
+    int refined = 0;
+    for (int x = 0; x <= extent; x += stride) {
+        for (int y = 0; y <= extentY; y += stride) {
+            uint64_t near = surface[x][y] | (((uint64_t)surface[x][y] << stride | surface[x][y] >> stride) & lattice);
+            if (y >= stride) near |= surface[x][y - stride];
+            if (y + stride <= extentY) near |= surface[x][y + stride];
+            if (x >= stride) near |= surface[x - stride][y];
+            if (x + stride <= extent) near |= surface[x + stride][y];
+            
+            for (int tz = 0; tz < 2; tz++) {
+                uint64_t tileBits = (((uint64_t)1 << DensityTile::size) - 1) << (tz * DensityTile::size);
+                if (!(near & tileBits) || !culledRows[(x * chunkHeight + y) * 2 + tz]) continue;
+                RefineRow(program, columns, x, y, tz);
+                refined++;
+            }
+        }
+    }
+    return refined;
+}
 
-    std::vector<std::thread> threads;
+// Redoes every culled row with a lattice point in [low, high] and brings back
+// the dropped sections it reaches, so an edit there starts from (and exposes)
+// exact values.
+int Terrain::RefineBox(glm::ivec3 low, glm::ivec3 high) {
+    const int stride = 1 << lod;
+    
+    low = glm::max(low, glm::ivec3(0));
+    high = glm::min(high, glm::ivec3(chunkWidth - 1, chunkHeight - 1, chunkWidth - 1));
+    int tzLow = low.z / DensityTile::size, tzHigh = high.z / DensityTile::size;
+    
+    ScratchLease scratch;
+    std::vector<glm::ivec3>& rows = scratch->rows;
+    rows.clear();
+    for (int s = low.y / sectionSize; s <= high.y / sectionSize; s++) {
+        if (density.Present(s)) continue;
+        density.Restore(s);
+        
+        for (int x = 0; x < chunkWidth; x += stride) {
+            for (int y = s * sectionSize; y < (s + 1) * sectionSize; y += stride) {
+                rows.push_back(glm::ivec3(x, y, 0));
+                rows.push_back(glm::ivec3(x, y, 1));
+            }
+        }
+    }
+    
+    if (!culledRows.empty()) {
+        for (int x = (low.x + stride - 1) / stride * stride; x <= high.x; x += stride) {
+            for (int y = (low.y + stride - 1) / stride * stride; y <= high.y; y += stride) {
+                for (int tz = tzLow; tz <= tzHigh; tz++) {
+                    if (culledRows[(x * chunkHeight + y) * 2 + tz] && density.Present(y / sectionSize)) rows.push_back(glm::ivec3(x, y, tz));
+                }
+            }
+        }
+    }
+    if (rows.empty()) return 0;
+    
+    std::shared_ptr<const DensityProgram> program = densityProgram(terrainParameters);
+    std::vector<float>& columns = scratch->columns;
+    SampleColumns(*program, worldFingerprint(), columns);
+    
+    for (const glm::ivec3& row : rows) RefineRow(*program, columns, row.x, row.y, row.z);
+    stats.rowsRefined += (int)rows.size();
+    return (int)rows.size();
+}
 
-    int chunkPerThread = size / numThreads;
-    int leftover = size % numThreads;
+// Drops every section whose lattice points, and those up to two strides above
+// and below it, are all on one side of the isolevel: no cube there can be
+// crossed by the surface, and no normal of one that is reads its values.
+void Terrain::CompactSections() {
+    const int stride = 1 << lod;
+    const float isolevel = 0.0f;
+    const int extent = lodExtent(chunkWidth, stride);
+    const int extentY = lodExtent(chunkHeight, stride);
+    
+    uint64_t lattice = 0;
+    for (int z = 0; z <= extent; z += stride) lattice |= (uint64_t)1 << z;
+    
+    for (int s = 0; s < chunkSections; s++) {
+        int yLow = std::max(s * sectionSize - 2 * stride, 0);
+        int yHigh = std::min((s + 1) * sectionSize - 1 + 2 * stride, extentY);
+        bool air = true, solid = true;
+        
+        for (int x = 0; x <= extent && (air || solid); x += stride) {
+            for (int y = yLow; y <= yHigh; y += stride) {
+                uint64_t signs = rowSigns(density.Row(x, y), isolevel) & lattice;
+                air = air && signs == 0;
+                solid = solid && signs == lattice;
+            }
+        }
+        if (air || solid) density.Drop(s, solid);
+    }
+    stats.sectionsStored = density.Stored();
+}
 
-    for (unsigned int t = 0; t < numThreads; ++t) {
-        int startX = t * chunkPerThread;
-        int endX = startX + chunkPerThread;
-        if (t == numThreads - 1) endX += leftover;
+// Output is sized from CountMesh up front; packed meshes are built as full
+// vertices in scratch and packed after, so neither grows while meshing.
+void Terrain::BuildMesh() {
+    PROFILE_CHUNK("mesh", chunkX, chunkZ);
+    const bool packed = vertexFormat == VertexFormat::Packed;
+    
+    ScratchLease scratch;
+    std::vector<Vertex>& meshVertices = packed ? scratch->vertices : vertices;
+    
+    vertices.clear();
+    packedVertices.clear();
+    indices.clear();
+    meshVertices.clear();
+    storedMesh = MeshView();
+    slabs.clear();
+    
+    stats.bricksTotal = bricksXZ * bricksY * bricksXZ;
+    stats.bricksSkipped = 0;
+    
+    for (int bx = 0; bx < bricksXZ; bx++) {
+        for (int by = 0; by < bricksY; by++) {
+            for (int bz = 0; bz < bricksXZ; bz++) {
+                if (!BrickActive(bx, by, bz)) stats.bricksSkipped++;
+            }
+        }
+    }
+    
+    int extent = lodExtent(chunkWidth, 1 << lod);
+    MeshCount count = CountMesh(0, extent);
+    stats.meshCounted = count;
+    if (packed) reserveScratch(meshVertices, count.vertices, ScratchArena::largestVertices);
+    else meshVertices.reserve(count.vertices);
+    indices.reserve(count.indices);
+    
+    // Threads with no other job waiting for them help mesh this chunk; when
+    // the queues are full (baking many chunks at once) it meshes in one pass.
+    int idle = (int)jobSystem.ThreadCount() - jobSystem.QueuedJobs();
+    int parts = parallelMeshing ? std::min(idle, extent >> lod) : 1;
+    CubeCount cubes;
+    
+    if (parts < 2 || !BuildMeshParts(parts, extent, meshVertices, cubes)) {
+        meshVertices.clear();
+        indices.clear();
+        cubes = CubeCount();
+        
+        if (meshMode == MeshMode::Indexed) BuildIndexedMesh(0, extent, meshVertices, indices, cubes);
+        else BuildFlatMesh(0, extent, meshVertices, cubes);
+    }
+    stats.cubesVisited = cubes.visited;
+    stats.cubesSkipped = cubes.skipped;
+    
+    if (lod > 0) AddSkirts(meshVertices, indices);
+    
+    // World-space bounds of the mesh for culling.
+    bounds = AABB();
+    for (const Vertex& vertex : meshVertices) bounds.Expand(vertex.vertex + position);
+    BuildOccluders();
+    
+    if (packed) {
+        packedVertices.resize(meshVertices.size());
+        for (size_t i = 0; i < meshVertices.size(); i++) {
+            packedVertices[i] = PackVertex(meshVertices[i]);
+        }
+    }
+    
+    PROFILE_COUNT(Triangles, TriangleCount());
+    PROFILE_COUNT(Vertices, VertexCount());
+}
 
-        threads.emplace_back([=, this]() {
-            for (int x = startX; x < endX; ++x) {
-                for (int y = 0; y < 256; ++y) {
-                    for (int z = 0; z < size; ++z) {
+// Marks an index a continued BuildIndexedMesh pass couldn't know: the low bits
+// are the edge's slot in the previous pass's last plane.
+const uint32_t sharedEdge = 1u << 31;
 
-                        float xi = (float)(x + seed + xOffset*8) * frequency / (float)size;
-                        float yi = (float)y * frequency / (float)size;
-                        float zi = (float)(z + seed + yOffset*8) * frequency / (float)size;
+// Meshes x in [0, extent) as parts x ranges at once. Each part meshes into
+// its own scratch; an exclusive prefix sum over their vertex and index counts
+// gives each part its place in the output, where it then copies itself in
+// parallel with the others, so the merged mesh is exactly the one a single
+// pass builds. The plane between two parts belongs to the first, as it would
+// in one pass, and the second resolves its references to it while copying.
+// Returns false (the caller meshes in one pass) if a reference didn't resolve.
+bool Terrain::BuildMeshParts(int parts, int extent, std::vector<Vertex>& meshVertices, CubeCount& cubes) {
+    const int stride = 1 << lod;
+    const int planeSize = chunkHeight * chunkWidth * 3;
+    const bool indexed = meshMode == MeshMode::Indexed;
+    
+    ScratchLease scratch;
+    std::vector<std::vector<Vertex>>& partVertices = scratch->slabVertices;
+    std::vector<std::vector<uint32_t>>& partIndices = scratch->slabIndices;
+    std::vector<std::vector<uint32_t>>& partPlanes = scratch->slabPlanes;
+    if ((int)partVertices.size() < parts) {
+        partVertices.resize(parts);
+        partIndices.resize(parts);
+    }
+    if ((int)partPlanes.size() < parts) partPlanes.resize(parts);
+    
+    std::array<CubeCount, chunkWidth> partCubes = {};
+    JobGroup meshing;
+    
+    for (int p = 0; p < parts; p++) {
+        int xBegin = p * (extent / stride) / parts * stride;
+        int xEnd = (p + 1) * (extent / stride) / parts * stride;
+        
+        jobSystem.Submit(meshing, [&, p, xBegin, xEnd] {
+            std::vector<Vertex>& vertexScratch = partVertices[p];
+            std::vector<uint32_t>& indexScratch = partIndices[p];
+            vertexScratch.clear();
+            indexScratch.clear();
+            reserveScratch(vertexScratch, 0, ScratchArena::largestSlabVertices);
+            reserveScratch(indexScratch, 0, ScratchArena::largestSlabIndices);
+            
+            if (indexed) {
+                partPlanes[p].resize(planeSize);
+                BuildIndexedMesh(xBegin, xEnd, vertexScratch, indexScratch, partCubes[p], p > 0, partPlanes[p].data());
+            }
+            else BuildFlatMesh(xBegin, xEnd, vertexScratch, partCubes[p]);
+            
+            // Records the sizes so every part's scratch starts big enough next time.
+            reserveScratch(vertexScratch, vertexScratch.size(), ScratchArena::largestSlabVertices);
+            reserveScratch(indexScratch, indexScratch.size(), ScratchArena::largestSlabIndices);
+        });
+    }
+    jobSystem.Wait(meshing);
+    
+    std::array<size_t, chunkWidth + 1> vertexStart, indexStart;
+    vertexStart[0] = indexStart[0] = 0;
+    for (int p = 0; p < parts; p++) {
+        vertexStart[p + 1] = vertexStart[p] + partVertices[p].size();
+        indexStart[p + 1] = indexStart[p] + partIndices[p].size();
+        cubes.visited += partCubes[p].visited;
+        cubes.skipped += partCubes[p].skipped;
+    }
+    meshVertices.resize(vertexStart[parts]);
+    indices.resize(indexStart[parts]);
+    
+    std::atomic<bool> resolved{true};
+    JobGroup merging;
+    
+    for (int p = 0; p < parts; p++) {
+        jobSystem.Submit(merging, [&, p] {
+            std::copy(partVertices[p].begin(), partVertices[p].end(), meshVertices.begin() + vertexStart[p]);
+            
+            const std::vector<uint32_t>& indexScratch = partIndices[p];
+            uint32_t* out = indices.data() + indexStart[p];
+            uint32_t start = (uint32_t)vertexStart[p];
+            
+            for (size_t n = 0; n < indexScratch.size(); n++) {
+                uint32_t index = indexScratch[n];
+                if (!(index & sharedEdge)) {
+                    out[n] = start + index;
+                    continue;
+                }
+                
+                uint32_t shared = partPlanes[p - 1][index & ~sharedEdge];
+                if (shared == UINT32_MAX) resolved.store(false, std::memory_order_relaxed);
+                out[n] = (uint32_t)vertexStart[p - 1] + shared;
+            }
+        });
+    }
+    jobSystem.Wait(merging);
+    
+    return resolved.load(std::memory_order_relaxed);
+}
 
-                        float mountainNoise = noiseLayer(xi, zi, lacunarity, persistence, 10, seed);
-                        float baseHeight = pow(mountainNoise, 1.0f) * heightScale;
-                        
-                        float basePlateau = noiseLayer(xi * 0.2f, zi * 0.2f, 1.2, 0.2, 3, seed);
-                        baseHeight += basePlateau * 5.0f + 5;
+// Drops or packs the float field according to densityRetention once the mesh
+// is built. EnsureDensity brings it back, resampling if nothing was kept.
+void Terrain::RetainDensity() {
+    if (densityRetention == DensityRetention::Full || density.Empty()) return;
+    
+    packedDensity.Pack(density, densityRetention);
+    density.Clear();
+}
 
-                        float caveNoise = noiseLayer(xi * caveFreq, yi * caveFreq, lacunarity, persistence, 10, zi * caveFreq);
-                        caveNoise = glm::clamp(caveNoise, 0.0f, caveNoise);
-                        
-                        float terrainSurface = (float)y - baseHeight;
-                        float _density = terrainSurface + caveNoise * 10.0f;
-                        
-                        if (y < 4) _density = -1.0f;
+// Coarse chunks get back the same every-stride-th-point field they were meshed
+// from. A resampled field has the chunk's edits applied again, in order.
+bool Terrain::EnsureDensity() {
+    if (!density.Empty()) return true;
+    
+    if (packedDensity.Unpack(density)) {
+        ComputeBrickRanges();
+        return true;
+    }
+    
+    SampleDensity(chunkX, chunkZ);
+    
+    std::vector<TerrainEdit> replay;
+    replay.swap(appliedEdits);
+    for (const TerrainEdit& edit : replay) ApplyEdit(edit);
+    return false;
+}
 
-                        density[index3D(x, y, z)] = _density;
+// Brick min/max over the lattice points of each brick including the shared
+// points on its far side. Coarse levels only hold (and only range over) every
+// stride-th point, so a brick without any is left empty (+inf, -inf). Only
+// bricks containing a lattice point in [low, high] are updated.
+void Terrain::ComputeBrickRanges(glm::ivec3 low, glm::ivec3 high) {
+    const int size = chunkWidth;
+    const int stride = 1 << lod;
+    
+    auto firstSample = [stride](int start) {
+        return (start + stride - 1) / stride * stride;
+    };
+    
+    auto firstBrick = [](int point) {
+        return std::max(point - 1, 0) / brickSize;
+    };
+    
+    for (int bx = firstBrick(low.x); bx <= std::min(high.x / brickSize, bricksXZ - 1); bx++) {
+        for (int by = firstBrick(low.y); by <= std::min(high.y / brickSize, bricksY - 1); by++) {
+            for (int bz = firstBrick(low.z); bz <= std::min(high.z / brickSize, bricksXZ - 1); bz++) {
+                float rangeLow = INFINITY;
+                float rangeHigh = -INFINITY;
+                
+                for (int x = firstSample(bx * brickSize); x <= std::min(bx * brickSize + brickSize, size - 1); x += stride) {
+                    for (int y = firstSample(by * brickSize); y <= std::min(by * brickSize + brickSize, chunkHeight - 1); y += stride) {
+                        const float* row = density.Row(x, y);
+                        for (int z = firstSample(bz * brickSize); z <= std::min(bz * brickSize + brickSize, size - 1); z += stride) {
+                            rangeLow = std::min(rangeLow, row[z]);
+                            rangeHigh = std::max(rangeHigh, row[z]);
+                        }
                     }
                 }
+                brickMin[brickIndex(bx, by, bz)] = rangeLow;
+                brickMax[brickIndex(bx, by, bz)] = rangeHigh;
             }
-        });
+        }
     }
+}
 
-    for (auto& t : threads) {
-        t.join();
+// Cubes per mesh slab along x; at least one coarse cube.
+int Terrain::SlabWidth() const {
+    return std::max(brickSize, 1 << lod);
+}
+
+// Applies the edit to the (stride-th) lattice points it covers and marks the
+// slabs whose cubes use them. Returns whether any density changed; edits that
+// did are kept in appliedEdits.
+bool Terrain::ApplyEdit(const TerrainEdit& edit) {
+    const int size = chunkWidth;
+    const int stride = 1 << lod;
+    
+    glm::vec3 low = edit.Min() - position;
+    glm::vec3 high = edit.Max() - position;
+    
+    int x0 = std::max((int)ceil(low.x / 2.0f), 0), x1 = std::min((int)floor(high.x / 2.0f), size - 1);
+    int y0 = std::max((int)ceil(low.y), 0),        y1 = std::min((int)floor(high.y), chunkHeight - 1);
+    int z0 = std::max((int)ceil(low.z / 2.0f), 0), z1 = std::min((int)floor(high.z / 2.0f), size - 1);
+    
+    x0 = (x0 + stride - 1) / stride * stride;
+    y0 = (y0 + stride - 1) / stride * stride;
+    z0 = (z0 + stride - 1) / stride * stride;
+    if (x0 > x1 || y0 > y1 || z0 > z1) return false;
+    
+    EnsureDensity();
+    
+    // New surface can only appear at edited points, and the mesher reads up to
+    // two strides around them. Dropped sections there come back first.
+    RefineBox(glm::ivec3(x0, y0, z0) - 2 * stride, glm::ivec3(x1, y1, z1) + 2 * stride);
+    
+    glm::ivec3 changedLow = glm::ivec3(INT32_MAX), changedHigh = glm::ivec3(-1);
+    
+    for (int x = x0; x <= x1; x += stride) {
+        for (int y = y0; y <= y1; y += stride) {
+            for (int z = z0; z <= z1; z += stride) {
+                float distance = edit.SignedDistance(position + glm::vec3(x * 2.0f, y, z * 2.0f));
+                float& value = density.WritableAt(x, y, z);
+                
+                // Density is positive in air, so digging raises it to at least the
+                // distance inside the shape and filling lowers it below the outside distance.
+                float edited = edit.operation == EditOperation::Dig ? std::max(value, -distance) : std::min(value, distance);
+                if (edited == value) continue;
+                
+                value = edited;
+                changedLow = glm::ivec3(std::min(changedLow.x, x), std::min(changedLow.y, y), std::min(changedLow.z, z));
+                changedHigh = glm::ivec3(std::max(changedHigh.x, x), std::max(changedHigh.y, y), std::max(changedHigh.z, z));
+            }
+        }
     }
+    if (changedHigh.x < 0) return false;
+    
+    appliedEdits.push_back(edit);
+    ComputeBrickRanges(changedLow, changedHigh);
+    
+    // Cubes read their corners and, for normals, the gradient one stride past
+    // each corner: from two strides before the first changed point up to one
+    // after the last.
+    int width = SlabWidth();
+    int lastCube = lodExtent(size, stride) - stride;
+    int firstDirty = std::max(changedLow.x - 2 * stride, 0) / width;
+    int lastDirty = std::min(changedHigh.x + stride, lastCube) / width;
+    
+    for (int i = firstDirty; i <= lastDirty && i < (int)slabs.size(); i++) {
+        slabs[i].dirty = true;
+    }
+    return true;
+}
+
+// Remeshes the dirty slabs into their sections. The first call after
+// generation (or a slab outgrowing its room) lays the whole mesh out again.
+void Terrain::RemeshDirty() {
+    PROFILE_CHUNK("remesh", chunkX, chunkZ);
+    const int stride = 1 << lod;
+    const int width = SlabWidth();
+    const int extent = lodExtent(chunkWidth, stride);
+    const int count = (extent + width - 1) / width;
+    const bool packed = vertexFormat == VertexFormat::Packed;
+    
+    bool relayout = slabs.empty();
+    if (relayout) {
+        slabs.assign(count, MeshSlab());
+        storedMesh = MeshView();
+    }
+    
+    EnsureDensity();
+    
+    ScratchLease scratch;
+    std::vector<std::vector<Vertex>>& slabVertices = scratch->slabVertices;
+    std::vector<std::vector<uint32_t>>& slabIndices = scratch->slabIndices;
+    if ((int)slabVertices.size() < count) {
+        slabVertices.resize(count);
+        slabIndices.resize(count);
+    }
+    
+    auto build = [&](int i) {
+        slabVertices[i].clear();
+        slabIndices[i].clear();
         
-    glm::vec3 vertexOffsets[8] = {
-        {0, 0, 0},
-        {1, 0, 0},
-        {1, 1, 0},
-        {0, 1, 0},
-        {0, 0, 1},
-        {1, 0, 1},
-        {1, 1, 1},
-        {0, 1, 1}
+        int xBegin = i * width, xEnd = std::min(xBegin + width, extent);
+        MeshCount slabCount = CountMesh(xBegin, xEnd);
+        reserveScratch(slabVertices[i], slabCount.vertices, ScratchArena::largestSlabVertices);
+        reserveScratch(slabIndices[i], slabCount.indices, ScratchArena::largestSlabIndices);
+        
+        CubeCount cubes;
+        if (meshMode == MeshMode::Indexed) BuildIndexedMesh(xBegin, xEnd, slabVertices[i], slabIndices[i], cubes);
+        else BuildFlatMesh(xBegin, xEnd, slabVertices[i], cubes);
+        if (lod > 0) AddSkirts(slabVertices[i], slabIndices[i]);
+        stats.cubesVisited += cubes.visited;
+        stats.cubesSkipped += cubes.skipped;
+        stats.slabsRemeshed++;
     };
+    
+    for (int i = 0; i < count; i++) {
+        if (!slabs[i].dirty) continue;
+        build(i);
+        if (slabVertices[i].size() > slabs[i].vertexCapacity || slabIndices[i].size() > slabs[i].indexCapacity) relayout = true;
+    }
+    
+    if (relayout) {
+        uint32_t vertexStart = 0, indexStart = 0;
+        
+        for (int i = 0; i < count; i++) {
+            if (!slabs[i].dirty) {
+                slabs[i].dirty = true;
+                build(i);
+            }
+            
+            MeshSlab& slab = slabs[i];
+            slab.vertexCapacity = (uint32_t)(slabVertices[i].size() * 3 / 2 + 64);
+            slab.indexCapacity = meshMode == MeshMode::Flat ? 0 : (uint32_t)(slabIndices[i].size() * 3 / 2 + 192);
+            slab.vertexStart = vertexStart;
+            slab.indexStart = indexStart;
+            vertexStart += slab.vertexCapacity;
+            indexStart += slab.indexCapacity;
+        }
+        
+        vertices.assign(packed ? 0 : vertexStart, Vertex());
+        packedVertices.assign(packed ? vertexStart : 0, PackedVertex());
+        indices.assign(indexStart, 0);
+        layoutChanged = true;
+    }
+    
+    for (int i = 0; i < count; i++) {
+        MeshSlab& slab = slabs[i];
+        if (!slab.dirty) continue;
+        
+        for (size_t v = 0; v < slabVertices[i].size(); v++) {
+            if (packed) packedVertices[slab.vertexStart + v] = PackVertex(slabVertices[i][v]);
+            else vertices[slab.vertexStart + v] = slabVertices[i][v];
+        }
+        for (size_t n = 0; n < slabIndices[i].size(); n++) {
+            indices[slab.indexStart + n] = slabIndices[i][n] + slab.vertexStart;
+        }
+        
+        slab.vertexCount = (uint32_t)slabVertices[i].size();
+        slab.indexCount = (uint32_t)slabIndices[i].size();
+        slab.dirty = false;
+        slab.stale = true;
+        
+        slab.bounds = AABB();
+        for (const Vertex& vertex : slabVertices[i]) slab.bounds.Expand(vertex.vertex + position);
+    }
+    
+    bounds = AABB();
+    for (const MeshSlab& slab : slabs) {
+        if (slab.bounds.Empty()) continue;
+        bounds.Expand(slab.bounds.min);
+        bounds.Expand(slab.bounds.max);
+    }
+    BuildOccluders();
+}
 
-    glm::ivec2 edgeVertexMap[12] = {
-        {0, 1}, {1, 2}, {2, 3}, {3, 0},
-        {4, 5}, {5, 6}, {6, 7}, {7, 4},
-        {0, 4}, {1, 5}, {2, 6}, {3, 7}
+// Occluder boxes from the brick ranges: a cell of max(brickSize, stride)
+// lattice units whose bricks are all below the isolevel has every lattice
+// point on and inside it solid, so it holds no surface at this level of
+// detail. Solid cells are merged up each column, and equal columns along z.
+// Neighbouring chunks overlap by half, so each chunk only covers its first
+// half in x and z and every piece of ground is drawn by one occluder.
+void Terrain::BuildOccluders() {
+    const float isolevel = 0.0f;
+    const int stride = 1 << lod;
+    const int cell = std::max(brickSize, stride);
+    const int extent = std::min(chunkWidth / 2, lodExtent(chunkWidth, stride));
+    const int extentY = lodExtent(chunkHeight, stride);
+    const int cellsXZ = (extent + cell - 1) / cell;
+    const int cellsY = (extentY + cell - 1) / cell;
+    
+    occluders.clear();
+    
+    // Bricks hold their far-side points too, so the bricks starting inside a
+    // cell cover every point of it; bricks holding no points don't count.
+    auto solid = [&](int cx, int cy, int cz) {
+        float high = -INFINITY;
+        bool sampled = false;
+        
+        for (int bx = cx * cell / brickSize; bx < std::min((cx + 1) * cell / brickSize, bricksXZ); bx++) {
+            for (int by = cy * cell / brickSize; by < std::min((cy + 1) * cell / brickSize, bricksY); by++) {
+                for (int bz = cz * cell / brickSize; bz < std::min((cz + 1) * cell / brickSize, bricksXZ); bz++) {
+                    int index = brickIndex(bx, by, bz);
+                    if (brickMin[index] > brickMax[index]) continue;
+                    high = std::max(high, brickMax[index]);
+                    sampled = true;
+                }
+            }
+        }
+        return sampled && high < isolevel;
     };
+    
+    for (int cx = 0; cx < cellsXZ; cx++) {
+        size_t previousColumn = occluders.size(), previousEnd = occluders.size();
+        
+        for (int cz = 0; cz < cellsXZ; cz++) {
+            size_t column = occluders.size();
+            
+            for (int cy = 0; cy < cellsY; cy++) {
+                if (!solid(cx, cy, cz)) continue;
+                
+                int top = cy;
+                while (top + 1 < cellsY && solid(cx, top + 1, cz)) top++;
+                
+                OccluderBox box;
+                box.low[0] = (uint8_t)(cx * cell);
+                box.low[1] = (uint8_t)(cy * cell);
+                box.low[2] = (uint8_t)(cz * cell);
+                box.high[0] = (uint8_t)std::min((cx + 1) * cell, extent);
+                box.high[1] = (uint8_t)std::min((top + 1) * cell, extentY);
+                box.high[2] = (uint8_t)std::min((cz + 1) * cell, extent);
+                occluders.push_back(box);
+                cy = top;
+            }
+            
+            // A column with the same runs as the one before it extends its boxes.
+            size_t runs = occluders.size() - column;
+            bool same = runs > 0 && runs == previousEnd - previousColumn;
+            for (size_t i = 0; same && i < runs; i++) {
+                same = occluders[column + i].low[1] == occluders[previousColumn + i].low[1] &&
+                       occluders[column + i].high[1] == occluders[previousColumn + i].high[1];
+            }
+            
+            if (same) {
+                for (size_t i = 0; i < runs; i++) occluders[previousColumn + i].high[2] = occluders[column + i].high[2];
+                occluders.resize(column);
+            }
+            else {
+                previousColumn = column;
+                previousEnd = occluders.size();
+            }
+        }
+    }
+}
 
-    for (int x = 0; x < size - 1; x++) {
-        for (int y = 0; y < 256 - 1; y++) {
-            for (int z = 0; z < size - 1; z++) {
-                float cubeValues[8];
-                glm::vec3 cubePositions[8];
+AABB Terrain::OccluderBounds(const OccluderBox& box) const {
+    glm::vec3 scale = glm::vec3(2.0f, 1.0f, 2.0f);
+    AABB bounds;
+    bounds.Expand(position + glm::vec3(box.low[0], box.low[1], box.low[2]) * scale);
+    bounds.Expand(position + glm::vec3(box.high[0], box.high[1], box.high[2]) * scale);
+    return bounds;
+}
+
+size_t Terrain::MemoryBytes() const {
+    return sizeof(Terrain)
+         + density.MemoryBytes()
+         + culledRows.capacity()
+         + appliedEdits.capacity() * sizeof(TerrainEdit)
+         + packedDensity.MemoryBytes()
+         + vertices.capacity() * sizeof(Vertex)
+         + packedVertices.capacity() * sizeof(PackedVertex)
+         + indices.capacity() * sizeof(uint32_t)
+         + occluders.capacity() * sizeof(OccluderBox);
+}
+
+bool Terrain::BrickActive(int bx, int by, int bz) {
+    const float isolevel = 0.0f;
+    int index = brickIndex(bx, by, bz);
+    
+    return !brickSkipping || (brickMin[index] < isolevel && brickMax[index] >= isolevel);
+}
+
+// Whether the unit cubes [x, x + span) x [y, y + span) x [z, z + spanZ) can
+// contain surface. A coarse cube spans several bricks, so their ranges are
+// merged rather than tested one by one.
+bool Terrain::RegionActive(int x, int y, int z, int span, int spanZ) {
+    const float isolevel = 0.0f;
+    
+    if (!brickSkipping) return true;
+    if (span == 1) return BrickActive(x / brickSize, y / brickSize, z / brickSize);
+    
+    float low = INFINITY, high = -INFINITY;
+    for (int bx = x / brickSize; bx <= (x + span - 1) / brickSize; bx++) {
+        for (int by = y / brickSize; by <= (y + span - 1) / brickSize; by++) {
+            for (int bz = z / brickSize; bz <= (z + spanZ - 1) / brickSize; bz++) {
+                low = std::min(low, brickMin[brickIndex(bx, by, bz)]);
+                high = std::max(high, brickMax[brickIndex(bx, by, bz)]);
+            }
+        }
+    }
+    return low < isolevel && high >= isolevel;
+}
+
+// Called at every cube of a z row. At the start of each brick-sized run,
+// returns how many lattice units of empty run the mesher can jump over.
+int Terrain::SkipInactive(int x, int y, int z) {
+    const int stride = 1 << lod;
+    const int block = std::max(brickSize, stride);
+    const int end = lodExtent(chunkWidth, stride);
+    
+    if (z % block != 0) return 0;
+    
+    int span = std::min(block, end - z);
+    return RegionActive(x, y, z, stride, span) ? 0 : span;
+}
+
+// For every triangle edge lying in one of the chunk's four side planes, adds a
+// quad hanging straight down from it. Every such edge belongs to exactly one
+// triangle, so each side contour gets one skirt.
+void Terrain::AddSkirts(std::vector<Vertex>& meshVertices, std::vector<uint32_t>& meshIndices) {
+    const int stride = 1 << lod;
+    const float maxX = lodExtent(chunkWidth, stride) * 2.0f;
+    const float depth = lodSkirtDepth * stride;
+    
+    auto sidePlane = [maxX](const glm::vec3& a, const glm::vec3& b) {
+        return (a.x == 0.0f && b.x == 0.0f) || (a.x == maxX && b.x == maxX) ||
+               (a.z == 0.0f && b.z == 0.0f) || (a.z == maxX && b.z == maxX);
+    };
+    
+    size_t edges = 0;
+    size_t corners = meshMode == MeshMode::Indexed ? meshIndices.size() : meshVertices.size();
+    for (size_t t = 0; t < corners; t += 3) {
+        for (int e = 0; e < 3; e++) {
+            size_t a = t + e, b = t + (e + 1) % 3;
+            if (meshMode == MeshMode::Indexed) edges += sidePlane(meshVertices[meshIndices[a]].vertex, meshVertices[meshIndices[b]].vertex);
+            else edges += sidePlane(meshVertices[a].vertex, meshVertices[b].vertex);
+        }
+    }
+    
+    if (meshMode == MeshMode::Indexed) {
+        size_t triangles = meshIndices.size();
+        meshVertices.reserve(meshVertices.size() + edges * 2);
+        meshIndices.reserve(meshIndices.size() + edges * 6);
+        
+        for (size_t t = 0; t < triangles; t += 3) {
+            for (int e = 0; e < 3; e++) {
+                uint32_t a = meshIndices[t + e], b = meshIndices[t + (e + 1) % 3];
+                if (!sidePlane(meshVertices[a].vertex, meshVertices[b].vertex)) continue;
                 
-                for (int i = 0; i < 8; ++i) {
-                    glm::vec3 pos = glm::vec3(x, y, z) + vertexOffsets[i];
-                    int px = static_cast<int>(pos.x);
-                    int py = static_cast<int>(pos.y);
-                    int pz = static_cast<int>(pos.z);
-                    
-                    cubePositions[i] = pos;
+                uint32_t lowA = (uint32_t)meshVertices.size();
+                uint32_t lowB = lowA + 1;
+                Vertex dropA = meshVertices[a], dropB = meshVertices[b];
+                dropA.vertex.y -= depth;
+                dropB.vertex.y -= depth;
+                meshVertices.push_back(dropA);
+                meshVertices.push_back(dropB);
+                
+                meshIndices.insert(meshIndices.end(), {b, a, lowA, b, lowA, lowB});
+            }
+        }
+    }
+    else {
+        size_t count = meshVertices.size();
+        meshVertices.reserve(count + edges * 6);
+        
+        for (size_t t = 0; t < count; t += 3) {
+            for (int e = 0; e < 3; e++) {
+                Vertex a = meshVertices[t + e], b = meshVertices[t + (e + 1) % 3];
+                if (!sidePlane(a.vertex, b.vertex)) continue;
+                
+                Vertex lowA = a, lowB = b;
+                lowA.vertex.y -= depth;
+                lowB.vertex.y -= depth;
+                
+                meshVertices.insert(meshVertices.end(), {b, a, lowA, b, lowA, lowB});
+            }
+        }
+    }
+}
 
-                    if (px >= 0 && px < size && py >= 0 && py < 256 && pz >= 0 && pz < size) {
-                        
-                        int index = index3D(px, py, pz);
-                        
-                        cubeValues[i] = density[index];
-                    }
-                    else {
-                        cubeValues[i] = 1.0f;
-                    }
+int Terrain::ClassifyCube(int x, int y, int z, int stride, float cubeValues[8], glm::vec3 cubePositions[8]) {
+    const int size = chunkWidth;
+    const float isolevel = 0.0f;
+    
+    for (int i = 0; i < 8; ++i) {
+        glm::vec3 pos = glm::vec3(x, y, z) + vertexOffsets[i] * (float)stride;
+        int px = static_cast<int>(pos.x);
+        int py = static_cast<int>(pos.y);
+        int pz = static_cast<int>(pos.z);
+        
+        cubePositions[i] = pos;
+
+        if (px >= 0 && px < size && py >= 0 && py < chunkHeight && pz >= 0 && pz < size) {
+            
+            cubeValues[i] = density.At(px, py, pz);
+        }
+        else {
+            cubeValues[i] = 1.0f;
+        }
+    }
+
+    int cubeIndex = 0;
+    for (int i = 0; i < 8; i++)
+        if (cubeValues[i] < isolevel) cubeIndex |= (1 << i);
+    
+    return cubeIndex;
+}
+
+// Sign bits of every z row of the x plane the mesher is at.
+void Terrain::ClassifyPlane(int x, int stride, RowMask signs[chunkHeight]) {
+    const float isolevel = 0.0f;
+    
+    for (int y = 0; y < chunkHeight; y += stride) {
+        int section = y / sectionSize;
+        signs[y] = density.Present(section) ? rowSigns(density.Row(x, y), isolevel) : density.Solid(section) ? (RowMask)~0ull : 0;
+    }
+}
+
+// Cube indices of the whole z row at (x, y) from the sign rows of the x and
+// x + stride planes. Returns false if every cube in the row is all inside or
+// all outside, so none of them produces triangles.
+inline bool classifyRow(const RowMask* near, const RowMask* far, int y, int stride, uint8_t cubeIndices[chunkWidth]) {
+    const int extent = lodExtent(chunkWidth, stride);
+    
+    uint64_t a = near[y], b = far[y], c = far[y + stride], d = near[y + stride];
+    
+    uint64_t lattice = 0;
+    for (int z = 0; z <= extent; z += stride) lattice |= (uint64_t)1 << z;
+    
+    uint64_t bits = a & lattice;
+    if (bits == (b & lattice) && bits == (c & lattice) && bits == (d & lattice) && (bits == 0 || bits == lattice)) return false;
+    
+    for (int z = 0, i = 0; z < extent; z += stride, i++) {
+        int z1 = z + stride;
+        cubeIndices[i] = (uint8_t)((a >> z & 1) | (b >> z & 1) << 1 | (c >> z & 1) << 2 | (d >> z & 1) << 3 |
+                                   (a >> z1 & 1) << 4 | (b >> z1 & 1) << 5 | (c >> z1 & 1) << 6 | (d >> z1 & 1) << 7);
+    }
+    return true;
+}
+
+// Per cube index, the triangles triTable gives it and, for each side face of
+// the cube (x low, x high, z low, z high), how many of their edges lie in it.
+struct CubeCounts {
+    uint8_t triangles[256];
+    uint8_t sideEdges[256][4];
+};
+
+const CubeCounts& cubeCounts() {
+    static const CubeCounts counts = [] {
+        CubeCounts table = {};
+        
+        auto onFace = [](int edge, int face) {
+            glm::vec3 a = vertexOffsets[edgeVertexMap[edge].x], b = vertexOffsets[edgeVertexMap[edge].y];
+            float side = face % 2 ? 1.0f : 0.0f;
+            return face < 2 ? a.x == side && b.x == side : a.z == side && b.z == side;
+        };
+        
+        for (int cube = 0; cube < 256; cube++) {
+            for (int i = 0; triTable[cube][i] != -1; i += 3) {
+                table.triangles[cube]++;
+                for (int e = 0; e < 3; e++) {
+                    int a = triTable[cube][i + e], b = triTable[cube][i + (e + 1) % 3];
+                    for (int face = 0; face < 4; face++) table.sideEdges[cube][face] += onFace(a, face) && onFace(b, face);
                 }
+            }
+        }
+        return table;
+    }();
+    return counts;
+}
+
+// What the mesher (and AddSkirts, at coarse levels) will emit for cubes from
+// x = xBegin to xEnd, from the sign masks alone: one vertex per lattice edge
+// the surface crosses when indexed, three per triangle when flat. Skirts are
+// counted from the cube faces on the chunk's sides, which misses the rare
+// vertex interpolated exactly onto a side from off it; AddSkirts reserves the
+// difference itself.
+MeshCount Terrain::CountMesh(int xBegin, int xEnd) {
+    const int stride = 1 << lod;
+    const int extent = lodExtent(chunkWidth, stride);
+    const int extentY = lodExtent(chunkHeight, stride);
+    const bool indexed = meshMode == MeshMode::Indexed;
+    const CubeCounts& counts = cubeCounts();
+    
+    uint64_t lattice = 0;
+    for (int z = 0; z <= extent; z += stride) lattice |= (uint64_t)1 << z;
+    uint64_t pairs = lattice & (lattice >> stride);
+    
+    size_t edges = 0, triangles = 0, sideEdges = 0;
+    
+    // Crossed edges along z and y in one x plane.
+    auto planeEdges = [&](const RowMask* signs) {
+        for (int y = 0; y <= extentY; y += stride) {
+            uint64_t row = signs[y];
+            edges += std::popcount((row ^ row >> stride) & pairs);
+            if (y + stride <= extentY) edges += std::popcount((row ^ signs[y + stride]) & lattice);
+        }
+    };
+    
+    RowMask planeSigns[2][chunkHeight];
+    RowMask* near = planeSigns[0];
+    RowMask* far = planeSigns[1];
+    ClassifyPlane(xBegin, stride, near);
+    if (indexed) planeEdges(near);
+    
+    for (int x = xBegin; x < xEnd; x += stride) {
+        ClassifyPlane(x + stride, stride, far);
+        if (indexed) {
+            planeEdges(far);
+            for (int y = 0; y <= extentY; y += stride) edges += std::popcount((uint64_t)(near[y] ^ far[y]) & lattice);
+        }
+        
+        for (int y = 0; y < extentY; y += stride) {
+            uint8_t rowCubes[chunkWidth];
+            if (!density.Present(y / sectionSize) || !classifyRow(near, far, y, stride, rowCubes)) continue;
+            
+            for (int z = 0, i = 0; z < extent; z += stride, i++) {
+                const uint8_t* sides = counts.sideEdges[rowCubes[i]];
+                triangles += counts.triangles[rowCubes[i]];
+                sideEdges += (x == 0 ? sides[0] : 0) + (x + stride == extent ? sides[1] : 0) +
+                             (z == 0 ? sides[2] : 0) + (z + stride == extent ? sides[3] : 0);
+            }
+        }
+        std::swap(near, far);
+    }
+    
+    if (lod == 0) sideEdges = 0;
+    
+    MeshCount count;
+    count.vertices = indexed ? edges + sideEdges * 2 : triangles * 3 + sideEdges * 6;
+    count.indices = indexed ? triangles * 3 + sideEdges * 6 : 0;
+    return count;
+}
+
+// Corners of a cube the mesher already knows is inside the chunk and crossed
+// by the surface.
+void Terrain::CubeCorners(int x, int y, int z, int stride, float cubeValues[8], glm::vec3 cubePositions[8]) {
+    for (int i = 0; i < 8; ++i) {
+        glm::ivec3 corner = glm::ivec3(x, y, z) + glm::ivec3(vertexOffsets[i]) * stride;
+        cubePositions[i] = glm::vec3(corner);
+        cubeValues[i] = density.At(corner.x, corner.y, corner.z);
+    }
+}
 
-                int cubeIndex = 0;
-                for (int i = 0; i < 8; i++)
-                    if (cubeValues[i] < isolevel) cubeIndex |= (1 << i);
+glm::vec3 Terrain::DensityGradient(int x, int y, int z, int stride) {
+    const int size = chunkWidth;
+    
+    int x0 = std::max(x - stride, 0), x1 = std::min(x + stride, lodExtent(size, stride));
+    int y0 = std::max(y - stride, 0), y1 = std::min(y + stride, lodExtent(chunkHeight, stride));
+    int z0 = std::max(z - stride, 0), z1 = std::min(z + stride, lodExtent(size, stride));
+    
+    const float* row = density.Row(x, y);
+    return glm::vec3((density.At(x1, y, z) - density.At(x0, y, z)) / (float)(x1 - x0),
+                     (density.At(x, y1, z) - density.At(x, y0, z)) / (float)(y1 - y0),
+                     (row[z1] - row[z0]) / (float)(z1 - z0));
+}
+
+void Terrain::BuildFlatMesh(int xBegin, int xEnd, std::vector<Vertex>& meshVertices, CubeCount& cubes) {
+    const int size = chunkWidth;
+    const int stride = 1 << lod;
+    const float isolevel = 0.0f;
+
+    RowMask planeSigns[2][chunkHeight];
+    RowMask* near = planeSigns[0];
+    RowMask* far = planeSigns[1];
+    if (signMasks) ClassifyPlane(xBegin, stride, near);
+
+    for (int x = xBegin; x < xEnd; x += stride) {
+        if (signMasks) ClassifyPlane(x + stride, stride, far);
+        
+        for (int y = 0; y < lodExtent(chunkHeight, stride); y += stride) {
+            // Dropped sections hold no surface (see CompactSections).
+            if (!density.Present(y / sectionSize)) {
+                int next = std::min((y / sectionSize + 1) * sectionSize, lodExtent(chunkHeight, stride));
+                cubes.skipped += (next - y) / stride * (lodExtent(size, stride) / stride);
+                y = next - stride;
+                continue;
+            }
+            
+            uint8_t rowCubes[chunkWidth];
+            if (signMasks && !classifyRow(near, far, y, stride, rowCubes)) {
+                cubes.skipped += lodExtent(size, stride) / stride;
+                continue;
+            }
+            
+            for (int z = 0; z < lodExtent(size, stride); z += stride) {
+                if (int skipped = SkipInactive(x, y, z)) {
+                    cubes.skipped += skipped / stride;
+                    z += skipped - stride;
+                    continue;
+                }
+                cubes.visited++;
+                
+                float cubeValues[8];
+                glm::vec3 cubePositions[8];
+                
+                int cubeIndex = signMasks ? rowCubes[z / stride] : ClassifyCube(x, y, z, stride, cubeValues, cubePositions);
 
                 if (edgeTable[cubeIndex] == 0) continue;
+                if (signMasks) CubeCorners(x, y, z, stride, cubeValues, cubePositions);
 
                 glm::vec3 edgeVertices[12];
 
@@ -183,31 +1600,210 @@ void Terrain::Generate(int xOffset, int yOffset) {
                     glm::vec3 normal = glm::normalize(glm::cross(v2 - v0, v1 - v0));
                     glm::vec3 scale = glm::vec3(2.0f, 1.0f, 2.0f);
                     
-                    vertices.push_back({v0 * scale, normal, glm::vec2(0.0f)});
-                    vertices.push_back({v1 * scale, normal, glm::vec2(0.0f)});
-                    vertices.push_back({v2 * scale, normal, glm::vec2(0.0f)});
+                    meshVertices.push_back({v0 * scale, normal, glm::vec2(0.0f)});
+                    meshVertices.push_back({v1 * scale, normal, glm::vec2(0.0f)});
+                    meshVertices.push_back({v2 * scale, normal, glm::vec2(0.0f)});
                 }
             }
         }
+        
+        std::swap(near, far);
     }
+}
+
+// A continued pass starts where another pass over the previous x range ended:
+// that pass emitted the vertices on the first plane's y and z edges, so they
+// are referred to as sharedEdge | their slot, for BuildMeshParts to resolve.
+// lastPlane, if given, receives the vertex index of every edge on the last plane.
+void Terrain::BuildIndexedMesh(int xBegin, int xEnd, std::vector<Vertex>& meshVertices, std::vector<uint32_t>& meshIndices,
+                               CubeCount& cubes, bool continued, uint32_t* lastPlane) {
+    const int size = chunkWidth;
+    const int stride = 1 << lod;
+    const float isolevel = 0.0f;
+    const uint32_t none = UINT32_MAX;
     
-    scale = glm::vec3(1.0f);
-    rotation = glm::vec3(0.0f);
-    position = glm::vec3(xOffset * size, -10.0f, yOffset * size);
+    // Vertex index for every lattice edge in the x and x + stride planes, 3 axes
+    // per lattice point. The far plane becomes the near plane of the next slab,
+    // so edges shared across cubes, rows and slabs are only emitted once.
+    const int slabSize = chunkHeight * size * 3;
+    ScratchLease scratch;
+    std::vector<uint32_t>& edgeCache = scratch->edgeCache;
+    edgeCache.assign(slabSize * 2, none);
+    uint32_t* slab[2] = {edgeCache.data(), edgeCache.data() + slabSize};
+    if (continued) {
+        for (int i = 0; i < slabSize; i++) {
+            if (i % 3 != 0) slab[0][i] = sharedEdge | i;
+        }
+    }
+    
+    glm::vec3 scale = glm::vec3(2.0f, 1.0f, 2.0f);
+
+    RowMask planeSigns[2][chunkHeight];
+    RowMask* near = planeSigns[0];
+    RowMask* far = planeSigns[1];
+    if (signMasks) ClassifyPlane(xBegin, stride, near);
+
+    for (int x = xBegin; x < xEnd; x += stride) {
+        if (signMasks) ClassifyPlane(x + stride, stride, far);
+        
+        for (int y = 0; y < lodExtent(chunkHeight, stride); y += stride) {
+            // Dropped sections hold no surface (see CompactSections).
+            if (!density.Present(y / sectionSize)) {
+                int next = std::min((y / sectionSize + 1) * sectionSize, lodExtent(chunkHeight, stride));
+                cubes.skipped += (next - y) / stride * (lodExtent(size, stride) / stride);
+                y = next - stride;
+                continue;
+            }
+            
+            uint8_t rowCubes[chunkWidth];
+            if (signMasks && !classifyRow(near, far, y, stride, rowCubes)) {
+                cubes.skipped += lodExtent(size, stride) / stride;
+                continue;
+            }
+            
+            for (int z = 0; z < lodExtent(size, stride); z += stride) {
+                if (int skipped = SkipInactive(x, y, z)) {
+                    cubes.skipped += skipped / stride;
+                    z += skipped - stride;
+                    continue;
+                }
+                cubes.visited++;
+                
+                float cubeValues[8];
+                glm::vec3 cubePositions[8];
+                
+                int cubeIndex = signMasks ? rowCubes[z / stride] : ClassifyCube(x, y, z, stride, cubeValues, cubePositions);
+
+                if (edgeTable[cubeIndex] == 0) continue;
+                if (signMasks) CubeCorners(x, y, z, stride, cubeValues, cubePositions);
+
+                uint32_t edgeIndices[12];
+
+                for (int i = 0; i < 12; i++) {
+                    if (!(edgeTable[cubeIndex] & (1 << i))) continue;
+                    
+                    glm::ivec3 base = glm::ivec3(x, y, z) + edgeBase[i] * stride;
+                    uint32_t& cached = slab[edgeBase[i].x][(base.y * size + base.z) * 3 + edgeAxis[i]];
+                    
+                    if (cached == none) {
+                        int v0 = edgeVertexMap[i].x;
+                        int v1 = edgeVertexMap[i].y;
+                        float val0 = cubeValues[v0];
+                        float val1 = cubeValues[v1];
+                        glm::vec3 p0 = cubePositions[v0];
+                        glm::vec3 p1 = cubePositions[v1];
+
+                        float denom = val1 - val0;
+                        float mu = 0.5f;
+                        if (fabs(denom) > 1e-5f) {
+                            mu = (isolevel - val0) / denom;
+                            mu = glm::clamp(mu, 0.0f, 1.0f);
+                        }
+                        
+                        // Density rises towards air, so its gradient is the outward normal.
+                        // Positions are stretched by scale, which divides the gradient.
+                        glm::vec3 g0 = DensityGradient((int)p0.x, (int)p0.y, (int)p0.z, stride);
+                        glm::vec3 g1 = DensityGradient((int)p1.x, (int)p1.y, (int)p1.z, stride);
+                        glm::vec3 gradient = (g0 + mu * (g1 - g0)) / scale;
+                        glm::vec3 normal = glm::length(gradient) > 1e-6f ? glm::normalize(gradient) : glm::vec3(0.0f, 1.0f, 0.0f);
+                        
+                        cached = (uint32_t)meshVertices.size();
+                        meshVertices.push_back({(p0 + mu * (p1 - p0)) * scale, normal, glm::vec2(0.0f)});
+                    }
+                    edgeIndices[i] = cached;
+                }
+
+                for (int i = 0; triTable[cubeIndex][i] != -1; i += 3) {
+                    meshIndices.push_back(edgeIndices[triTable[cubeIndex][i]]);
+                    meshIndices.push_back(edgeIndices[triTable[cubeIndex][i + 1]]);
+                    meshIndices.push_back(edgeIndices[triTable[cubeIndex][i + 2]]);
+                }
+            }
+        }
+        
+        std::swap(slab[0], slab[1]);
+        std::fill(slab[1], slab[1] + slabSize, none);
+        std::swap(near, far);
+    }
+    
+    if (lastPlane) std::copy(slab[0], slab[0] + slabSize, lastPlane);
+}
+
+MeshView Terrain::Mesh() const {
+    if (storedMesh.owner) return storedMesh;
     
-    glGenVertexArrays(1, &vertexArrayObject);
-    glBindVertexArray(vertexArrayObject);
+    MeshView mesh = MeshView();
+    mesh.packed = !packedVertices.empty();
+    mesh.vertices = mesh.packed ? (const void*)packedVertices.data() : (const void*)vertices.data();
+    mesh.vertexCount = vertices.size() + packedVertices.size();
+    mesh.indices = indices.data();
+    mesh.indexCount = indices.size();
+    return mesh;
+}
+
+size_t Terrain::VertexCount() const {
+    if (slabs.empty()) return Mesh().vertexCount;
+    
+    size_t count = 0;
+    for (const MeshSlab& slab : slabs) count += slab.vertexCount;
+    return count;
+}
+
+size_t Terrain::TriangleCount() const {
+    if (slabs.empty()) {
+        MeshView mesh = Mesh();
+        return (mesh.indexCount ? mesh.indexCount : mesh.vertexCount) / 3;
+    }
     
-    glGenBuffers(1, &vertexBufferObject);
-    glBindBuffer(GL_ARRAY_BUFFER, vertexBufferObject);
-    glBufferData(GL_ARRAY_BUFFER, vertices.size() * sizeof(Vertex), vertices.data(), GL_DYNAMIC_DRAW);
+    size_t count = 0;
+    for (const MeshSlab& slab : slabs) count += slab.indexCount ? slab.indexCount : slab.vertexCount;
+    return count / 3;
+}
+
+// Checksums for golden comparisons: bit-exact, so any change to the generator's
+// arithmetic or output order shows up.
+uint64_t Terrain::MeshHash() const {
+    MeshView mesh = Mesh();
+    uint64_t hash = fnv1a(mesh.vertices, mesh.VertexBytes());
+    return fnv1a((const void*)mesh.indices, mesh.indexCount * sizeof(uint32_t), hash);
+}
+
+// The triangles as the vertex data they draw, in order: the same for a mesh
+// remeshed slab by slab as for one built in a single pass, whatever vertices
+// they share and whatever room the slabs leave between them.
+uint64_t Terrain::TriangleHash() const {
+    MeshView mesh = Mesh();
+    const uint8_t* vertexData = static_cast<const uint8_t*>(mesh.vertices);
+    const size_t vertexSize = mesh.packed ? sizeof(PackedVertex) : sizeof(Vertex);
+    uint64_t hash = fnvOffset;
+    
+    auto hashRange = [&](size_t start, size_t count) {
+        for (size_t n = start; n < start + count; n++) {
+            size_t vertex = mesh.indexCount ? mesh.indices[n] : n;
+            hash = fnv1a((const void*)(vertexData + vertex * vertexSize), vertexSize, hash);
+        }
+    };
+    
+    if (slabs.empty()) hashRange(0, mesh.indexCount ? mesh.indexCount : mesh.vertexCount);
+    for (const MeshSlab& slab : slabs) {
+        if (mesh.indexCount) hashRange(slab.indexStart, slab.indexCount);
+        else hashRange(slab.vertexStart, slab.vertexCount);
+    }
+    return hash;
+}
+
+// The float field is hashed as the mesher reads it, dropped sections as their fill.
+uint64_t Terrain::DensityHash() const {
+    if (!density.Empty()) {
+        uint64_t hash = fnvOffset;
+        for (int x = 0; x < chunkWidth; x++) {
+            for (int y = 0; y < chunkHeight; y++) hash = fnv1a((const void*)density.Row(x, y), chunkWidth * sizeof(float), hash);
+        }
+        return hash;
+    }
     
-    glEnableVertexAttribArray(0);
-    glEnableVertexAttribArray(1);
-    glEnableVertexAttribArray(2);
-    glVertexAttribPointer(0, 3, GL_FLOAT, GL_FALSE, sizeof(Vertex), (void*)offsetof(Vertex, vertex));
-    glVertexAttribPointer(1, 3, GL_FLOAT, GL_FALSE, sizeof(Vertex), (void*)offsetof(Vertex, normal));
-    glVertexAttribPointer(2, 2, GL_FLOAT, GL_FALSE, sizeof(Vertex), (void*)offsetof(Vertex, uv));
+    uint64_t hash = fnv1a((const void*)packedDensity.data.data(), packedDensity.data.size() * sizeof(uint16_t));
+    return fnv1a((const void*)packedDensity.columnStart.data(), packedDensity.columnStart.size() * sizeof(uint32_t), hash);
 }
 
 glm::mat4 Terrain::CreateModelMatrix() {
@@ -228,4 +1824,47 @@ glm::mat4 Terrain::CreateModelMatrix() {
     return model;
 }
 
+struct OcclusionStats {
+    int occluders = 0, triangles = 0, tested = 0, occluded = 0;
+    double rasterSeconds = 0.0, pyramidSeconds = 0.0, testSeconds = 0.0;
+};
+
+// Removes the chunks hidden behind terrain from visible (the chunks that
+// passed the frustum test). Chunks within occluderDistance of the eye draw
+// their occluder boxes first; every chunk is then tested against them.
+OcclusionStats cullOccluded(OcclusionBuffer& occlusion, const glm::mat4& viewProjection, glm::vec3 eye,
+                            float occluderDistance, std::vector<const Terrain*>& visible) {
+    OcclusionStats stats;
+    auto start = std::chrono::steady_clock::now();
+    
+    occlusion.Begin(viewProjection, eye);
+    for (const Terrain* terrain : visible) {
+        glm::vec3 closest = glm::max(terrain->bounds.min, glm::min(eye, terrain->bounds.max));
+        if (terrain->occluders.empty() || glm::length(closest - eye) > occluderDistance) continue;
+        
+        stats.occluders++;
+        for (const OccluderBox& box : terrain->occluders) {
+            AABB bounds = terrain->OccluderBounds(box);
+            occlusion.AddBox(bounds.min, bounds.max);
+        }
+    }
+    stats.triangles = occlusion.triangles;
+    auto rasterized = std::chrono::steady_clock::now();
+    
+    occlusion.BuildPyramid();
+    auto built = std::chrono::steady_clock::now();
+    
+    stats.tested = (int)visible.size();
+    visible.erase(std::remove_if(visible.begin(), visible.end(), [&](const Terrain* terrain) {
+        return occlusion.Occluded(terrain->bounds);
+    }), visible.end());
+    stats.occluded = stats.tested - (int)visible.size();
+    
+    auto tested = std::chrono::steady_clock::now();
+    stats.rasterSeconds = std::chrono::duration<double>(rasterized - start).count();
+    stats.pyramidSeconds = std::chrono::duration<double>(built - rasterized).count();
+    stats.testSeconds = std::chrono::duration<double>(tested - built).count();
+    return stats;
+}
+
 #endif /* terrain_h */
@@ -0,0 +1,365 @@
+//
+//  terrainBatch.h
+//  Marching Cube Terrain
+//
+//  Created by Dmitri Wamback on 2026-10-16.
+//
+
+#ifndef terrainBatch_h
+#define terrainBatch_h
+
+#include <unordered_map>
+
+// Chunk meshes live in a few large pages, each a vertex buffer, an index
+// buffer and a VAO, sub-allocated with RangeAllocator. A chunk goes in the
+// first page with room and a new page is only opened when none has; freed
+// ranges are reused and nothing is ever reallocated or copied, so memory stays
+// flat across regenerations. Uploads go through the staging ring.
+//
+// Draw turns the visible chunks (or their slabs, once edited) into one
+// indirect command each, with the chunk's position as a per-draw attribute
+// fetched through baseInstance, and submits one glMultiDraw*Indirect per page.
+// When that isn't available (GL < 4.3, e.g. macOS) it falls back to one
+// glDrawElementsBaseVertex per command with the position in a uniform.
+
+struct DrawElementsIndirectCommand {
+    uint32_t count;
+    uint32_t instanceCount;
+    uint32_t firstIndex;
+    int32_t baseVertex;
+    uint32_t baseInstance;
+};
+
+struct DrawArraysIndirectCommand {
+    uint32_t count;
+    uint32_t instanceCount;
+    uint32_t first;
+    uint32_t baseInstance;
+};
+
+struct ArenaReport {
+    int pages = 0;
+    size_t reservedBytes = 0, usedBytes = 0;
+    size_t largestHoleBytes = 0;
+    size_t freeRanges = 0;
+    
+    // Share of free space outside each buffer's largest hole.
+    float Fragmentation() const {
+        size_t freeBytes = reservedBytes - usedBytes;
+        return freeBytes ? 1.0f - (float)largestHoleBytes / freeBytes : 0.0f;
+    }
+};
+
+class TerrainBatch {
+public:
+    bool indirect = false;
+    int drawCalls = 0, drawCommands = 0;
+    StagingRing staging;
+    
+    static void Initialize();
+    void Add(const Terrain& terrain);
+    void Remove(const Terrain& terrain);
+    void Update(Terrain& terrain);
+    void Draw(Shader& shader, const std::vector<const Terrain*>& terrains);
+    void Clear();
+    ArenaReport Report();
+private:
+    struct Page {
+        uint32_t vertexArrayObject = 0;
+        uint32_t vertexBuffer = 0, indexBuffer = 0;
+        RangeAllocator vertexRanges, indexRanges;
+        
+        std::vector<DrawElementsIndirectCommand> elementCommands;
+        std::vector<DrawArraysIndirectCommand> arrayCommands;
+    };
+    
+    struct Allocation {
+        int page;
+        uint32_t vertexOffset, vertexCount;
+        uint32_t indexOffset, indexCount;
+    };
+    
+    static constexpr uint32_t pageVertices = 1 << 20;
+    static constexpr uint32_t pageIndices = 1 << 21;
+    
+    int OpenPage(uint32_t vertexCount, uint32_t indexCount);
+    void SetupVertexArray(Page& page);
+    
+    bool packed = false;
+    bool indexed = true;
+    size_t vertexSize = sizeof(Vertex);
+    
+    std::vector<Page> pages;
+    uint32_t offsetBuffer = 0, commandBuffer = 0;
+    std::unordered_map<const Terrain*, Allocation> allocations;
+    
+    std::vector<glm::vec3> drawOffsets;
+    std::vector<DrawElementsIndirectCommand> elementCommands;
+    std::vector<DrawArraysIndirectCommand> arrayCommands;
+};
+
+TerrainBatch terrainBatch;
+
+void TerrainBatch::Initialize() {
+    terrainBatch.Clear();
+    
+    terrainBatch.indirect = GLEW_VERSION_4_3 || GLEW_ARB_multi_draw_indirect;
+    terrainBatch.packed = vertexFormat == VertexFormat::Packed;
+    terrainBatch.indexed = meshMode == MeshMode::Indexed;
+    terrainBatch.vertexSize = terrainBatch.packed ? sizeof(PackedVertex) : sizeof(Vertex);
+    
+    glGenBuffers(1, &terrainBatch.offsetBuffer);
+    glGenBuffers(1, &terrainBatch.commandBuffer);
+    
+    terrainBatch.staging.Initialize(16 << 20);
+    terrainBatch.OpenPage(0, 0);
+}
+
+// Pages are a fixed size unless a single mesh needs more.
+int TerrainBatch::OpenPage(uint32_t vertexCount, uint32_t indexCount) {
+    pages.emplace_back();
+    Page& page = pages.back();
+    
+    uint32_t vertices = std::max(pageVertices, vertexCount);
+    uint32_t indices = indexed ? std::max(pageIndices, indexCount) : 0;
+    page.vertexRanges = RangeAllocator(vertices);
+    page.indexRanges = RangeAllocator(indices);
+    
+    glGenVertexArrays(1, &page.vertexArrayObject);
+    glGenBuffers(1, &page.vertexBuffer);
+    glBindBuffer(GL_COPY_WRITE_BUFFER, page.vertexBuffer);
+    glBufferData(GL_COPY_WRITE_BUFFER, vertices * vertexSize, nullptr, GL_STATIC_DRAW);
+    
+    if (indexed) {
+        glGenBuffers(1, &page.indexBuffer);
+        glBindBuffer(GL_COPY_WRITE_BUFFER, page.indexBuffer);
+        glBufferData(GL_COPY_WRITE_BUFFER, indices * sizeof(uint32_t), nullptr, GL_STATIC_DRAW);
+    }
+    
+    SetupVertexArray(page);
+    return (int)pages.size() - 1;
+}
+
+void TerrainBatch::SetupVertexArray(Page& page) {
+    glBindVertexArray(page.vertexArrayObject);
+    glBindBuffer(GL_ARRAY_BUFFER, page.vertexBuffer);
+    if (indexed) glBindBuffer(GL_ELEMENT_ARRAY_BUFFER, page.indexBuffer);
+    
+    glEnableVertexAttribArray(0);
+    glEnableVertexAttribArray(1);
+    
+    if (packed) {
+        glVertexAttribPointer(0, 3, GL_UNSIGNED_SHORT, GL_FALSE, sizeof(PackedVertex), (void*)offsetof(PackedVertex, x));
+        glVertexAttribPointer(1, 2, GL_BYTE, GL_FALSE, sizeof(PackedVertex), (void*)offsetof(PackedVertex, normal));
+    }
+    else {
+        glEnableVertexAttribArray(2);
+        glVertexAttribPointer(0, 3, GL_FLOAT, GL_FALSE, sizeof(Vertex), (void*)offsetof(Vertex, vertex));
+        glVertexAttribPointer(1, 3, GL_FLOAT, GL_FALSE, sizeof(Vertex), (void*)offsetof(Vertex, normal));
+        glVertexAttribPointer(2, 2, GL_FLOAT, GL_FALSE, sizeof(Vertex), (void*)offsetof(Vertex, uv));
+    }
+    
+    if (indirect) {
+        glBindBuffer(GL_ARRAY_BUFFER, offsetBuffer);
+        glEnableVertexAttribArray(3);
+        glVertexAttribPointer(3, 3, GL_FLOAT, GL_FALSE, sizeof(glm::vec3), (void*)0);
+        glVertexAttribDivisor(3, 1);
+    }
+    glBindVertexArray(0);
+}
+
+void TerrainBatch::Add(const Terrain& terrain) {
+    PROFILE_CHUNK("upload", terrain.chunkX, terrain.chunkZ);
+    MeshView mesh = terrain.Mesh();
+    if (mesh.packed != packed || allocations.count(&terrain)) return;
+    
+    Allocation allocation = {-1, 0, (uint32_t)mesh.vertexCount, 0, indexed ? (uint32_t)mesh.indexCount : 0};
+    
+    for (int i = 0; i < (int)pages.size() && allocation.page < 0; i++) {
+        Page& page = pages[i];
+        if (page.vertexRanges.LargestFree() < allocation.vertexCount || page.indexRanges.LargestFree() < allocation.indexCount) continue;
+        
+        page.vertexRanges.Allocate(allocation.vertexCount, allocation.vertexOffset);
+        page.indexRanges.Allocate(allocation.indexCount, allocation.indexOffset);
+        allocation.page = i;
+    }
+    
+    if (allocation.page < 0) {
+        allocation.page = OpenPage(allocation.vertexCount, allocation.indexCount);
+        pages[allocation.page].vertexRanges.Allocate(allocation.vertexCount, allocation.vertexOffset);
+        pages[allocation.page].indexRanges.Allocate(allocation.indexCount, allocation.indexOffset);
+    }
+    
+    const Page& page = pages[allocation.page];
+    staging.Copy(page.vertexBuffer, (size_t)allocation.vertexOffset * vertexSize, mesh.vertices, mesh.VertexBytes());
+    staging.Copy(page.indexBuffer, (size_t)allocation.indexOffset * sizeof(uint32_t), mesh.indices, allocation.indexCount * sizeof(uint32_t));
+    
+    allocations[&terrain] = allocation;
+}
+
+void TerrainBatch::Remove(const Terrain& terrain) {
+    auto found = allocations.find(&terrain);
+    if (found == allocations.end()) return;
+    
+    const Allocation& allocation = found->second;
+    pages[allocation.page].vertexRanges.Free(allocation.vertexOffset, allocation.vertexCount);
+    pages[allocation.page].indexRanges.Free(allocation.indexOffset, allocation.indexCount);
+    allocations.erase(found);
+}
+
+// Sends the slabs an edit remeshed, or moves the chunk if its layout changed.
+void TerrainBatch::Update(Terrain& terrain) {
+    PROFILE_CHUNK("upload", terrain.chunkX, terrain.chunkZ);
+    auto found = allocations.find(&terrain);
+    
+    if (terrain.layoutChanged || found == allocations.end()) {
+        Remove(terrain);
+        Add(terrain);
+        terrain.layoutChanged = false;
+        for (MeshSlab& slab : terrain.slabs) slab.stale = false;
+        return;
+    }
+    
+    MeshView mesh = terrain.Mesh();
+    const Allocation& allocation = found->second;
+    const Page& page = pages[allocation.page];
+    
+    for (MeshSlab& slab : terrain.slabs) {
+        if (!slab.stale) continue;
+        
+        staging.Copy(page.vertexBuffer, (size_t)(allocation.vertexOffset + slab.vertexStart) * vertexSize,
+                     (const uint8_t*)mesh.vertices + slab.vertexStart * vertexSize, slab.vertexCount * vertexSize);
+        
+        if (indexed) {
+            staging.Copy(page.indexBuffer, (size_t)(allocation.indexOffset + slab.indexStart) * sizeof(uint32_t),
+                         mesh.indices + slab.indexStart, slab.indexCount * sizeof(uint32_t));
+        }
+        slab.stale = false;
+    }
+}
+
+void TerrainBatch::Draw(Shader& shader, const std::vector<const Terrain*>& terrains) {
+    PROFILE_SCOPE("draw");
+    
+    // Everything uploaded so far is read by the copies before this frame's draws.
+    staging.Fence();
+    
+    drawOffsets.clear();
+    for (Page& page : pages) {
+        page.elementCommands.clear();
+        page.arrayCommands.clear();
+    }
+    
+    for (const Terrain* terrain : terrains) {
+        auto found = allocations.find(terrain);
+        if (found == allocations.end()) continue;
+        const Allocation& allocation = found->second;
+        Page& page = pages[allocation.page];
+        
+        auto command = [&](uint32_t vertexStart, uint32_t vertexCount, uint32_t indexStart, uint32_t indexCount) {
+            uint32_t instance = (uint32_t)drawOffsets.size();
+            drawOffsets.push_back(terrain->position);
+            
+            if (indexed) page.elementCommands.push_back({indexCount, 1, allocation.indexOffset + indexStart, (int32_t)allocation.vertexOffset, instance});
+            else page.arrayCommands.push_back({vertexCount, 1, allocation.vertexOffset + vertexStart, instance});
+        };
+        
+        if (terrain->slabs.empty()) {
+            command(0, allocation.vertexCount, 0, allocation.indexCount);
+        }
+        else {
+            for (const MeshSlab& slab : terrain->slabs) {
+                if (slab.vertexCount) command(slab.vertexStart, slab.vertexCount, slab.indexStart, slab.indexCount);
+            }
+        }
+    }
+    
+    drawCommands = (int)drawOffsets.size();
+    drawCalls = 0;
+    if (!drawCommands) return;
+    
+    if (indirect) {
+        shader.SetInt("offsetSource", 1);
+        
+        glBindBuffer(GL_ARRAY_BUFFER, offsetBuffer);
+        glBufferData(GL_ARRAY_BUFFER, drawOffsets.size() * sizeof(glm::vec3), drawOffsets.data(), GL_STREAM_DRAW);
+        
+        // All pages' commands go up in one buffer, each page drawing its own run.
+        elementCommands.clear();
+        arrayCommands.clear();
+        for (const Page& page : pages) {
+            elementCommands.insert(elementCommands.end(), page.elementCommands.begin(), page.elementCommands.end());
+            arrayCommands.insert(arrayCommands.end(), page.arrayCommands.begin(), page.arrayCommands.end());
+        }
+        
+        glBindBuffer(GL_DRAW_INDIRECT_BUFFER, commandBuffer);
+        if (indexed) glBufferData(GL_DRAW_INDIRECT_BUFFER, elementCommands.size() * sizeof(DrawElementsIndirectCommand), elementCommands.data(), GL_STREAM_DRAW);
+        else glBufferData(GL_DRAW_INDIRECT_BUFFER, arrayCommands.size() * sizeof(DrawArraysIndirectCommand), arrayCommands.data(), GL_STREAM_DRAW);
+        
+        size_t first = 0;
+        for (const Page& page : pages) {
+            size_t count = indexed ? page.elementCommands.size() : page.arrayCommands.size();
+            if (!count) continue;
+            
+            glBindVertexArray(page.vertexArrayObject);
+            if (indexed) glMultiDrawElementsIndirect(GL_TRIANGLES, GL_UNSIGNED_INT, (void*)(first * sizeof(DrawElementsIndirectCommand)), (GLsizei)count, 0);
+            else glMultiDrawArraysIndirect(GL_TRIANGLES, (void*)(first * sizeof(DrawArraysIndirectCommand)), (GLsizei)count, 0);
+            
+            first += count;
+            drawCalls++;
+        }
+    }
+    else {
+        shader.SetInt("offsetSource", 2);
+        int origin = shader.UniformLocation("chunkOrigin");
+        
+        for (const Page& page : pages) {
+            glBindVertexArray(page.vertexArrayObject);
+            
+            for (const DrawElementsIndirectCommand& command : page.elementCommands) {
+                glUniform3fv(origin, 1, &drawOffsets[command.baseInstance][0]);
+                glDrawElementsBaseVertex(GL_TRIANGLES, command.count, GL_UNSIGNED_INT, (void*)(command.firstIndex * sizeof(uint32_t)), command.baseVertex);
+            }
+            for (const DrawArraysIndirectCommand& command : page.arrayCommands) {
+                glUniform3fv(origin, 1, &drawOffsets[command.baseInstance][0]);
+                glDrawArrays(GL_TRIANGLES, command.first, command.count);
+            }
+        }
+        drawCalls = drawCommands;
+    }
+    
+    glBindVertexArray(0);
+}
+
+void TerrainBatch::Clear() {
+    allocations.clear();
+    staging.Release();
+    
+    for (Page& page : pages) {
+        uint32_t buffers[2] = {page.vertexBuffer, page.indexBuffer};
+        glDeleteBuffers(page.indexBuffer ? 2 : 1, buffers);
+        glDeleteVertexArrays(1, &page.vertexArrayObject);
+    }
+    pages.clear();
+    
+    if (offsetBuffer) {
+        uint32_t buffers[2] = {offsetBuffer, commandBuffer};
+        glDeleteBuffers(2, buffers);
+    }
+    offsetBuffer = commandBuffer = 0;
+}
+
+ArenaReport TerrainBatch::Report() {
+    ArenaReport report;
+    report.pages = (int)pages.size();
+    
+    for (const Page& page : pages) {
+        report.reservedBytes += (size_t)page.vertexRanges.Size() * vertexSize + (size_t)page.indexRanges.Size() * sizeof(uint32_t);
+        report.usedBytes += (size_t)page.vertexRanges.Used() * vertexSize + (size_t)page.indexRanges.Used() * sizeof(uint32_t);
+        report.largestHoleBytes += (size_t)page.vertexRanges.LargestFree() * vertexSize + (size_t)page.indexRanges.LargestFree() * sizeof(uint32_t);
+        report.freeRanges += page.vertexRanges.FreeRanges() + page.indexRanges.FreeRanges();
+    }
+    return report;
+}
+
+#endif /* terrainBatch_h */
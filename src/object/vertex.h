@@ -14,4 +14,55 @@ struct Vertex {
     glm::vec2 uv;
 };
 
+// 8-byte terrain vertex: chunk-local position in 8.8 fixed point (a chunk spans
+// at most 126 x 255 x 126 units, so 16 bits covers it) and an octahedral normal in 2 x 8 bits.
+// vMain.glsl decodes it when packedVertices is set.
+struct PackedVertex {
+    uint16_t x, y, z;
+    int8_t normal[2];
+};
+
+enum class VertexFormat {
+    Full,
+    Packed
+};
+
+#ifndef TERRAIN_PACKED_VERTICES
+#define TERRAIN_PACKED_VERTICES 1
+#endif
+
+VertexFormat vertexFormat = TERRAIN_PACKED_VERTICES ? VertexFormat::Packed : VertexFormat::Full;
+
+const float packedPositionScale = 256.0f;
+
+glm::vec2 octahedralEncode(glm::vec3 n) {
+    n /= (fabs(n.x) + fabs(n.y) + fabs(n.z));
+    if (n.z >= 0.0f) return glm::vec2(n.x, n.y);
+    
+    return glm::vec2((1.0f - fabs(n.y)) * (n.x >= 0.0f ? 1.0f : -1.0f),
+                     (1.0f - fabs(n.x)) * (n.y >= 0.0f ? 1.0f : -1.0f));
+}
+
+glm::vec3 octahedralDecode(glm::vec2 e) {
+    glm::vec3 n = glm::vec3(e.x, e.y, 1.0f - fabs(e.x) - fabs(e.y));
+    float t = std::max(-n.z, 0.0f);
+    n.x += n.x >= 0.0f ? -t : t;
+    n.y += n.y >= 0.0f ? -t : t;
+    return glm::normalize(n);
+}
+
+PackedVertex PackVertex(const Vertex& vertex) {
+    glm::vec3 position = glm::clamp(vertex.vertex * packedPositionScale + 0.5f, 0.0f, 65535.0f);
+    glm::vec2 normal = octahedralEncode(vertex.normal) * 127.0f;
+    
+    return {(uint16_t)position.x, (uint16_t)position.y, (uint16_t)position.z,
+            {(int8_t)roundf(normal.x), (int8_t)roundf(normal.y)}};
+}
+
+Vertex UnpackVertex(const PackedVertex& vertex) {
+    return {glm::vec3(vertex.x, vertex.y, vertex.z) / packedPositionScale,
+            octahedralDecode(glm::vec2(vertex.normal[0], vertex.normal[1]) / 127.0f),
+            glm::vec2(0.0f)};
+}
+
 #endif /* vertex_h */
@@ -9,10 +9,28 @@
 layout (location = 0) in vec3 position;
 layout (location = 1) in vec3 normal;
 layout (location = 2) in vec2 uv;
+layout (location = 3) in vec3 drawOffset;
 
 uniform mat4 projection;
 uniform mat4 lookAt;
 uniform mat4 model;
+uniform int packedVertices;
+
+// 0: model matrix (single chunk), 1: per-draw drawOffset (multi-draw),
+// 2: chunkOrigin uniform (one draw per chunk). Batched chunks are only
+// translated, so their normals need no transform.
+uniform int offsetSource;
+uniform vec3 chunkOrigin;
+
+// Packed vertices carry 8.8 fixed-point positions and a 2 x 8 bit octahedral
+// normal in normal.xy (see PackedVertex in vertex.h).
+vec3 octahedralDecode(vec2 e) {
+    vec3 n = vec3(e, 1.0 - abs(e.x) - abs(e.y));
+    float t = max(-n.z, 0.0);
+    n.x += n.x >= 0.0 ? -t : t;
+    n.y += n.y >= 0.0 ? -t : t;
+    return normalize(n);
+}
 
 out prop {
     vec3 normal;
@@ -20,9 +38,18 @@ out prop {
 } vs_out;
 
 void main() {
-    vs_out.normal = normalize(transpose(inverse(mat3(model))) * normal);
-    vs_out.fragp = vec3(model * vec4(position, 1.0));
+    vec3 p = packedVertices != 0 ? position / 256.0 : position;
+    vec3 n = packedVertices != 0 ? octahedralDecode(normal.xy / 127.0) : normal;
+    
+    if (offsetSource == 0) {
+        vs_out.normal = normalize(transpose(inverse(mat3(model))) * n);
+        vs_out.fragp = vec3(model * vec4(p, 1.0));
+    }
+    else {
+        vs_out.normal = n;
+        vs_out.fragp = p + (offsetSource == 1 ? drawOffset : chunkOrigin);
+    }
 
-    gl_Position = projection * lookAt * model * vec4(position, 1.0);
+    gl_Position = projection * lookAt * vec4(vs_out.fragp, 1.0);
     gl_PointSize = 20.0;
 }
@@ -0,0 +1,65 @@
+//
+//  allocationCounter.h
+//  Marching Cube Terrain
+//
+//  Created by Dmitri Wamback on 2026-10-16.
+//
+
+#ifndef allocationCounter_h
+#define allocationCounter_h
+
+#include <atomic>
+#include <algorithm>
+#include <cstddef>
+#include <cstdlib>
+#include <new>
+
+// Counts every heap allocation made through operator new, so bake can show
+// that generating chunks in steady state doesn't touch the heap. Replacing the
+// global operators affects the whole program: only bake.cpp includes this.
+std::atomic<uint64_t> heapAllocations{0};
+
+// Every replaced operator goes through these two, kept out of line: once GCC
+// inlines free() into a delete it sees memory from operator new being freed
+// and warns (-Wmismatched-new-delete), though the pair here matches.
+[[gnu::noinline]] void* countedAllocate(size_t size, size_t align) noexcept {
+    heapAllocations.fetch_add(1, std::memory_order_relaxed);
+    if (align <= alignof(std::max_align_t)) return malloc(size ? size : 1);
+    return aligned_alloc(align, (std::max<size_t>(size, 1) + align - 1) / align * align);
+}
+
+[[gnu::noinline]] void countedRelease(void* memory) noexcept {
+    free(memory);
+}
+
+void* operator new(size_t size) {
+    if (void* memory = countedAllocate(size, 0)) return memory;
+    throw std::bad_alloc();
+}
+
+void* operator new(size_t size, std::align_val_t alignment) {
+    if (void* memory = countedAllocate(size, (size_t)alignment)) return memory;
+    throw std::bad_alloc();
+}
+
+void* operator new[](size_t size) { return operator new(size); }
+void* operator new[](size_t size, std::align_val_t alignment) { return operator new(size, alignment); }
+void* operator new(size_t size, const std::nothrow_t&) noexcept { return countedAllocate(size, 0); }
+void* operator new[](size_t size, const std::nothrow_t&) noexcept { return countedAllocate(size, 0); }
+void* operator new(size_t size, std::align_val_t alignment, const std::nothrow_t&) noexcept { return countedAllocate(size, (size_t)alignment); }
+void* operator new[](size_t size, std::align_val_t alignment, const std::nothrow_t&) noexcept { return countedAllocate(size, (size_t)alignment); }
+
+void operator delete(void* memory) noexcept { countedRelease(memory); }
+void operator delete[](void* memory) noexcept { countedRelease(memory); }
+void operator delete(void* memory, size_t) noexcept { countedRelease(memory); }
+void operator delete[](void* memory, size_t) noexcept { countedRelease(memory); }
+void operator delete(void* memory, std::align_val_t) noexcept { countedRelease(memory); }
+void operator delete[](void* memory, std::align_val_t) noexcept { countedRelease(memory); }
+void operator delete(void* memory, size_t, std::align_val_t) noexcept { countedRelease(memory); }
+void operator delete[](void* memory, size_t, std::align_val_t) noexcept { countedRelease(memory); }
+void operator delete(void* memory, const std::nothrow_t&) noexcept { countedRelease(memory); }
+void operator delete[](void* memory, const std::nothrow_t&) noexcept { countedRelease(memory); }
+void operator delete(void* memory, std::align_val_t, const std::nothrow_t&) noexcept { countedRelease(memory); }
+void operator delete[](void* memory, std::align_val_t, const std::nothrow_t&) noexcept { countedRelease(memory); }
+
+#endif /* allocationCounter_h */
@@ -0,0 +1,44 @@
+//
+//  chunkDimensions.h
+//  Marching Cube Terrain
+//
+//  Created by Dmitri Wamback on 2026-10-16.
+//
+
+#ifndef chunkDimensions_h
+#define chunkDimensions_h
+
+#include <type_traits>
+
+// Chunk shape, fixed at compile time: -DTERRAIN_CHUNK_WIDTH=32 or 64 builds
+// wider chunks, -DTERRAIN_CHUNK_HEIGHT a shorter column. A chunk is chunkWidth
+// lattice columns 2 units apart in x and z and chunkHeight points tall, and a
+// new one starts every chunkWidth / 2 columns, so neighbours overlap by half.
+
+#ifndef TERRAIN_CHUNK_WIDTH
+#define TERRAIN_CHUNK_WIDTH 16
+#endif
+
+#ifndef TERRAIN_CHUNK_HEIGHT
+#define TERRAIN_CHUNK_HEIGHT 256
+#endif
+
+const int chunkWidth = TERRAIN_CHUNK_WIDTH;
+const int chunkHeight = TERRAIN_CHUNK_HEIGHT;
+
+// The density field is kept in vertical sections of sectionSize rows, each of
+// which can be dropped when it is all air or all solid (see densityField.h).
+const int sectionSize = 16;
+const int chunkSections = chunkHeight / sectionSize;
+
+static_assert(chunkWidth == 16 || chunkWidth == 32 || chunkWidth == 64, "chunk rows are sign-masked 16, 32 or 64 points at a time");
+static_assert(chunkHeight % sectionSize == 0 && chunkHeight <= 256, "packed vertices hold heights up to 255");
+
+// Noise coordinates advance frequency / noiseColumnScale per lattice column
+// whatever the chunk width, so every width generates the same world.
+const float noiseColumnScale = 16.0f;
+
+// Sign bits of one z row of a chunk, bit z for column z (see densitySigns.h).
+using RowMask = std::conditional_t<chunkWidth == 16, uint16_t, std::conditional_t<chunkWidth == 32, uint32_t, uint64_t>>;
+
+#endif /* chunkDimensions_h */
@@ -0,0 +1,333 @@
+//
+//  chunkStore.h
+//  Marching Cube Terrain
+//
+//  Created by Dmitri Wamback on 2026-10-16.
+//
+
+#ifndef chunkStore_h
+#define chunkStore_h
+
+#include <filesystem>
+
+#if !defined(_WIN32)
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <fcntl.h>
+#include <unistd.h>
+#else
+#include <process.h>
+#define getpid _getpid
+#endif
+
+// Read-only file mapping; falls back to reading the file where mmap isn't available.
+class MappedFile {
+public:
+    ~MappedFile();
+    static std::shared_ptr<MappedFile> Open(const std::string& path);
+    
+    const uint8_t* data = nullptr;
+    size_t size = 0;
+private:
+    std::vector<uint8_t> contents;
+};
+
+std::shared_ptr<MappedFile> MappedFile::Open(const std::string& path) {
+    std::shared_ptr<MappedFile> file = std::make_shared<MappedFile>();
+    
+#if !defined(_WIN32)
+    int descriptor = open(path.c_str(), O_RDONLY);
+    if (descriptor < 0) return nullptr;
+    
+    struct stat info;
+    if (fstat(descriptor, &info) != 0 || info.st_size == 0) {
+        close(descriptor);
+        return nullptr;
+    }
+    
+    void* mapping = mmap(nullptr, info.st_size, PROT_READ, MAP_PRIVATE, descriptor, 0);
+    close(descriptor);
+    if (mapping == MAP_FAILED) return nullptr;
+    
+    file->data = static_cast<const uint8_t*>(mapping);
+    file->size = info.st_size;
+#else
+    std::ifstream stream(path, std::ios::binary);
+    if (!stream.is_open()) return nullptr;
+    
+    file->contents.assign(std::istreambuf_iterator<char>(stream), std::istreambuf_iterator<char>());
+    file->data = file->contents.data();
+    file->size = file->contents.size();
+#endif
+    return file;
+}
+
+MappedFile::~MappedFile() {
+#if !defined(_WIN32)
+    if (data) munmap(const_cast<uint8_t*>(data), size);
+#endif
+}
+
+// One record per chunk and level of detail under <root>/<fingerprint>/<x>.<z>.<lod>.chunk. The
+// fingerprint covers the seed, TerrainParameters, mesh and vertex format, the
+// noise instruction set (SIMD noise only matches scalar to within
+// noiseRowTolerance) and the store version, so changing any of them switches
+// to a fresh directory; records whose header doesn't match are treated as
+// misses and deleted.
+//
+// Record: ChunkStoreHeader, vertices, indices, (optionally) the packed
+// density data and column starts, then the occluder boxes and a bit per
+// culled row. Every section is 4-byte aligned so a hit can hand the mapped
+// vertices and indices straight to glBufferData.
+
+struct ChunkStoreHeader {
+    char magic[4];
+    uint32_t version;
+    uint64_t fingerprint;
+    int32_t x, z;
+    int32_t lod;
+    uint32_t packedVertices;
+    uint32_t vertexCount;
+    uint32_t indexCount;
+    uint32_t densityMode;
+    uint32_t densityCount;
+    uint32_t columnCount;
+    uint32_t droppedSections;
+    uint32_t occluderCount;
+    uint32_t culledWords;
+    float boundsMin[3], boundsMax[3];
+};
+
+class ChunkStore {
+public:
+    static constexpr uint32_t version = 6;
+    
+    bool enabled = false;
+    bool storeDensity = true;
+    std::string root;
+    std::atomic<uint64_t> hits{0}, misses{0}, writes{0}, stale{0};
+    
+    static void Open(const std::string& root);
+    uint64_t Fingerprint();
+    bool Load(int x, int z, int lod, Terrain& terrain);
+    void Save(const Terrain& terrain);
+    int Prune();
+private:
+    std::string Directory(uint64_t fingerprint);
+    std::string Path(uint64_t fingerprint, int x, int z, int lod);
+};
+
+ChunkStore chunkStore;
+
+static size_t alignStore(size_t offset) {
+    return (offset + 3) & ~(size_t)3;
+}
+
+void ChunkStore::Open(const std::string& root) {
+    chunkStore.root = root;
+    chunkStore.enabled = true;
+    
+    std::error_code error;
+    std::filesystem::create_directories(root, error);
+    if (error) chunkStore.enabled = false;
+}
+
+uint64_t ChunkStore::Fingerprint() {
+    uint64_t hash = worldFingerprint();
+    hash = fnv1a(meshMode, hash);
+    hash = fnv1a(vertexFormat, hash);
+    hash = fnv1a(lodSkirtDepth, hash);
+    hash = fnv1a(octaveCulling, hash);
+    hash = fnv1a(noiseIsa, hash);
+    hash = fnv1a(chunkWidth, hash);
+    hash = fnv1a(chunkHeight, hash);
+    hash = fnv1a((uint32_t)version, hash);
+    return hash;
+}
+
+std::string ChunkStore::Directory(uint64_t fingerprint) {
+    char name[17];
+    snprintf(name, sizeof(name), "%016llx", (unsigned long long)fingerprint);
+    return root + "/" + name;
+}
+
+std::string ChunkStore::Path(uint64_t fingerprint, int x, int z, int lod) {
+    return Directory(fingerprint) + "/" + std::to_string(x) + "." + std::to_string(z) + "." + std::to_string(lod) + ".chunk";
+}
+
+bool ChunkStore::Load(int x, int z, int lod, Terrain& terrain) {
+    uint64_t fingerprint = Fingerprint();
+    std::string path = Path(fingerprint, x, z, lod);
+    
+    std::shared_ptr<MappedFile> file = MappedFile::Open(path);
+    if (!file) {
+        misses++;
+        return false;
+    }
+    
+    const ChunkStoreHeader* header = reinterpret_cast<const ChunkStoreHeader*>(file->data);
+    size_t vertexBytes = 0, indexOffset = 0, densityOffset = 0, columnOffset = 0, occluderOffset = 0, culledOffset = 0, end = 0;
+    
+    bool valid = file->size >= sizeof(ChunkStoreHeader) &&
+                 !memcmp(header->magic, "MCCS", 4) &&
+                 header->version == version &&
+                 header->fingerprint == fingerprint &&
+                 header->x == x && header->z == z && header->lod == lod;
+    if (valid) {
+        vertexBytes = header->vertexCount * (header->packedVertices ? sizeof(PackedVertex) : sizeof(Vertex));
+        indexOffset = alignStore(sizeof(ChunkStoreHeader) + vertexBytes);
+        densityOffset = alignStore(indexOffset + header->indexCount * sizeof(uint32_t));
+        columnOffset = alignStore(densityOffset + header->densityCount * sizeof(uint16_t));
+        occluderOffset = alignStore(columnOffset + header->columnCount * sizeof(uint32_t));
+        culledOffset = alignStore(occluderOffset + header->occluderCount * sizeof(OccluderBox));
+        end = culledOffset + header->culledWords * sizeof(uint32_t);
+        valid = file->size >= end;
+    }
+    
+    if (!valid) {
+        stale++;
+        misses++;
+        std::error_code error;
+        std::filesystem::remove(path, error);
+        return false;
+    }
+    
+    // The terrain may be a recycled one: clear what the record doesn't replace.
+    terrain.vertices.clear();
+    terrain.packedVertices.clear();
+    terrain.indices.clear();
+    terrain.slabs.clear();
+    terrain.layoutChanged = false;
+    terrain.density.Clear();
+    terrain.culledRows.clear();
+    terrain.appliedEdits.clear();
+    terrain.stats = GenerationStats();
+    terrain.lod = lod;
+    terrain.Place(x, z);
+    
+    MeshView mesh = MeshView();
+    mesh.packed = header->packedVertices != 0;
+    mesh.vertices = file->data + sizeof(ChunkStoreHeader);
+    mesh.vertexCount = header->vertexCount;
+    mesh.indices = reinterpret_cast<const uint32_t*>(file->data + indexOffset);
+    mesh.indexCount = header->indexCount;
+    mesh.owner = file;
+    terrain.storedMesh = mesh;
+    terrain.bounds.min = glm::vec3(header->boundsMin[0], header->boundsMin[1], header->boundsMin[2]);
+    terrain.bounds.max = glm::vec3(header->boundsMax[0], header->boundsMax[1], header->boundsMax[2]);
+    
+    terrain.packedDensity.Reset();
+    terrain.packedDensity.mode = (DensityRetention)header->densityMode;
+    terrain.packedDensity.droppedSections = header->droppedSections;
+    
+    const uint16_t* densityData = reinterpret_cast<const uint16_t*>(file->data + densityOffset);
+    const uint32_t* columnData = reinterpret_cast<const uint32_t*>(file->data + columnOffset);
+    terrain.packedDensity.data.assign(densityData, densityData + header->densityCount);
+    terrain.packedDensity.columnStart.assign(columnData, columnData + header->columnCount);
+    
+    const OccluderBox* occluderData = reinterpret_cast<const OccluderBox*>(file->data + occluderOffset);
+    terrain.occluders.assign(occluderData, occluderData + header->occluderCount);
+    
+    // Rows whose density is only bounded, which an edit refines before using them.
+    const uint32_t* culledData = reinterpret_cast<const uint32_t*>(file->data + culledOffset);
+    if (header->culledWords) {
+        terrain.culledRows.resize(header->culledWords * 32);
+        for (size_t row = 0; row < terrain.culledRows.size(); row++) terrain.culledRows[row] = culledData[row / 32] >> (row % 32) & 1;
+    }
+    
+    hits++;
+    return true;
+}
+
+void ChunkStore::Save(const Terrain& terrain) {
+    uint64_t fingerprint = Fingerprint();
+    MeshView mesh = terrain.Mesh();
+    
+    const PackedDensity& density = terrain.packedDensity;
+    bool withDensity = storeDensity && !density.data.empty();
+    
+    // Without density the loaded chunk resamples, which finds its culled rows again.
+    std::vector<uint32_t> culled(withDensity ? (terrain.culledRows.size() + 31) / 32 : 0, 0);
+    for (size_t row = 0; row < culled.size() * 32 && row < terrain.culledRows.size(); row++) {
+        culled[row / 32] |= (uint32_t)(terrain.culledRows[row] != 0) << (row % 32);
+    }
+    
+    ChunkStoreHeader header = {
+        {'M', 'C', 'C', 'S'}, version, fingerprint, terrain.chunkX, terrain.chunkZ, terrain.lod,
+        mesh.packed ? 1u : 0u, (uint32_t)mesh.vertexCount, (uint32_t)mesh.indexCount,
+        (uint32_t)(withDensity ? density.mode : DensityRetention::Discard),
+        withDensity ? (uint32_t)density.data.size() : 0u,
+        withDensity ? (uint32_t)density.columnStart.size() : 0u,
+        withDensity ? density.droppedSections : 0u,
+        (uint32_t)terrain.occluders.size(),
+        (uint32_t)culled.size(),
+        {terrain.bounds.min.x, terrain.bounds.min.y, terrain.bounds.min.z},
+        {terrain.bounds.max.x, terrain.bounds.max.y, terrain.bounds.max.z}
+    };
+    
+    std::error_code error;
+    std::filesystem::create_directories(Directory(fingerprint), error);
+    
+    // Written under a temporary name and renamed so readers never map half a
+    // record. The name is unique per process and thread, since the window and
+    // bakes can share a store.
+    std::string path = Path(fingerprint, terrain.chunkX, terrain.chunkZ, terrain.lod);
+    std::string temporary = path + ".tmp" + std::to_string(getpid()) + "." + std::to_string(std::hash<std::thread::id>()(std::this_thread::get_id()));
+    
+    std::ofstream file(temporary, std::ios::binary | std::ios::trunc);
+    if (!file.is_open()) return;
+    
+    const char padding[4] = {0, 0, 0, 0};
+    size_t offset = 0;
+    auto write = [&](const void* data, size_t bytes) {
+        size_t aligned = alignStore(offset);
+        file.write(padding, aligned - offset);
+        file.write(static_cast<const char*>(data), bytes);
+        offset = aligned + bytes;
+    };
+    
+    write(&header, sizeof(header));
+    write(mesh.vertices, mesh.VertexBytes());
+    write(mesh.indices, mesh.indexCount * sizeof(uint32_t));
+    if (withDensity) {
+        write(density.data.data(), density.data.size() * sizeof(uint16_t));
+        write(density.columnStart.data(), density.columnStart.size() * sizeof(uint32_t));
+    }
+    write(terrain.occluders.data(), terrain.occluders.size() * sizeof(OccluderBox));
+    write(culled.data(), culled.size() * sizeof(uint32_t));
+    file.close();
+    
+    if (file.fail()) {
+        std::filesystem::remove(temporary, error);
+        return;
+    }
+    std::filesystem::rename(temporary, path, error);
+    writes++;
+}
+
+// Deletes every fingerprint directory other than the current one.
+int ChunkStore::Prune() {
+    std::error_code error;
+    std::string current = Directory(Fingerprint());
+    int removed = 0;
+    
+    for (const auto& entry : std::filesystem::directory_iterator(root, error)) {
+        if (entry.is_directory() && entry.path() != std::filesystem::path(current)) {
+            std::filesystem::remove_all(entry.path(), error);
+            removed++;
+        }
+    }
+    return removed;
+}
+
+// Cache-aware replacement for Terrain::Generate. Edited chunks bypass the
+// store, which only ever holds generated terrain.
+void loadOrGenerateChunk(Terrain& terrain, int x, int z, int lod = 0, const std::vector<TerrainEdit>& edits = {}) {
+    bool cached = chunkStore.enabled && edits.empty();
+    if (cached && chunkStore.Load(x, z, lod, terrain)) return;
+    
+    terrain.Generate(x, z, lod, edits);
+    if (cached) chunkStore.Save(terrain);
+}
+
+#endif /* chunkStore_h */
@@ -0,0 +1,76 @@
+//
+//  chunkWriter.h
+//  Marching Cube Terrain
+//
+//  Created by Dmitri Wamback on 2026-10-16.
+//
+
+#ifndef chunkWriter_h
+#define chunkWriter_h
+
+// File layout: ChunkFileHeader, then one ChunkRecord per chunk followed by
+// vertexCount raw Vertex or PackedVertex structs (per vertexFormat) and
+// indexCount uint32_t indices (0 for flat meshes). Chunks are written as soon as they are
+// meshed so nothing but the current chunk is held in memory.
+
+struct ChunkFileHeader {
+    char magic[4];
+    uint32_t version;
+    float seed;
+    uint32_t vertexFormat;
+    int32_t originX, originZ;
+    int32_t width, depth;
+};
+
+struct ChunkRecord {
+    int32_t x, z;
+    uint32_t vertexCount;
+    uint32_t indexCount;
+};
+
+class ChunkWriter {
+public:
+    static const uint32_t version = 3;
+    
+    static ChunkWriter Open(const std::string& path, float seed, int originX, int originZ, int width, int depth);
+    bool IsOpen();
+    void Write(int x, int z, const Terrain& terrain);
+    void Close();
+    
+    uint64_t bytesWritten = 0;
+private:
+    std::ofstream file;
+};
+
+ChunkWriter ChunkWriter::Open(const std::string& path, float seed, int originX, int originZ, int width, int depth) {
+    ChunkWriter writer = ChunkWriter();
+    
+    writer.file.open(path, std::ios::binary | std::ios::trunc);
+    if (!writer.file.is_open()) return writer;
+    
+    ChunkFileHeader header = {{'M', 'C', 'T', 'B'}, version, seed, (uint32_t)vertexFormat, originX, originZ, width, depth};
+    writer.file.write(reinterpret_cast<const char*>(&header), sizeof(header));
+    writer.bytesWritten += sizeof(header);
+    
+    return writer;
+}
+
+bool ChunkWriter::IsOpen() {
+    return file.is_open() && file.good();
+}
+
+void ChunkWriter::Write(int x, int z, const Terrain& terrain) {
+    MeshView mesh = terrain.Mesh();
+    ChunkRecord record = {x, z, (uint32_t)mesh.vertexCount, (uint32_t)mesh.indexCount};
+    
+    file.write(reinterpret_cast<const char*>(&record), sizeof(record));
+    file.write(reinterpret_cast<const char*>(mesh.vertices), mesh.VertexBytes());
+    file.write(reinterpret_cast<const char*>(mesh.indices), mesh.indexCount * sizeof(uint32_t));
+    bytesWritten += sizeof(record) + mesh.VertexBytes() + mesh.indexCount * sizeof(uint32_t);
+}
+
+void ChunkWriter::Close() {
+    file.close();
+}
+
+#endif /* chunkWriter_h */
@@ -0,0 +1,176 @@
+//
+//  densityCodec.h
+//  Marching Cube Terrain
+//
+//  Created by Dmitri Wamback on 2026-10-16.
+//
+
+#ifndef densityCodec_h
+#define densityCodec_h
+
+// What a chunk keeps of its density field once it has been meshed. Discarded
+// fields are resampled from noise when something needs them again; Half and
+// Compressed are lossy (Compressed saturates at +-compressedDensityBand, which
+// only matters for cubes right next to very steep faces).
+enum class DensityRetention {
+    Full,
+    Discard,
+    Half,
+    Compressed
+};
+
+DensityRetention densityRetention = DensityRetention::Compressed;
+
+const float compressedDensityBand = 16.0f;
+
+// Values too small for a half flush to zero, except that negative ones become
+// the smallest negative half: the mesher tests density < 0, and -0 would turn
+// a solid point into air.
+uint16_t floatToHalf(float value) {
+    uint32_t bits;
+    memcpy(&bits, &value, sizeof(bits));
+    
+    uint32_t sign = (bits >> 16) & 0x8000;
+    int32_t exponent = (int32_t)((bits >> 23) & 0xff) - 127 + 15;
+    uint32_t mantissa = bits & 0x7fffff;
+    
+    if (exponent <= 0) return (uint16_t)(sign && (bits & 0x7fffffff) ? 0x8001 : sign);
+    if (exponent >= 31) return (uint16_t)(sign | 0x7c00);
+    
+    uint32_t half = sign | (exponent << 10) | (mantissa >> 13);
+    if (mantissa & 0x1000) half++;
+    return (uint16_t)half;
+}
+
+float halfToFloat(uint16_t half) {
+    uint32_t sign = (uint32_t)(half & 0x8000) << 16;
+    uint32_t exponent = (half >> 10) & 0x1f;
+    uint32_t mantissa = half & 0x3ff;
+    
+    uint32_t bits = sign;
+    if (exponent == 31) bits |= 0x7f800000 | (mantissa << 13);
+    else if (exponent != 0) bits |= ((exponent - 15 + 127) << 23) | (mantissa << 13);
+    else if (mantissa != 0) return (sign ? -1.0f : 1.0f) * ldexpf((float)mantissa, -24);
+    
+    float value;
+    memcpy(&value, &bits, sizeof(value));
+    return value;
+}
+
+// Half: one half per voxel in the same x, y, z order as the float field.
+// Compressed: per (x, z) column, (run length, half value) pairs along y, with
+// columnStart giving each column's first pair. Sections the field had dropped
+// are dropped again on unpacking.
+struct PackedDensity {
+    DensityRetention mode = DensityRetention::Discard;
+    std::vector<uint16_t> data;
+    std::vector<uint32_t> columnStart;
+    uint32_t droppedSections = 0;
+    
+    void Pack(const DensityField& density, DensityRetention mode);
+    bool Unpack(DensityField& density) const;
+    void Reset();
+    size_t MemoryBytes() const;
+};
+
+// Packs in place, reusing whatever room data and columnStart already have.
+void PackedDensity::Pack(const DensityField& density, DensityRetention mode) {
+    this->mode = mode;
+    droppedSections = density.DroppedMask();
+    data.clear();
+    columnStart.clear();
+    
+    if (mode == DensityRetention::Half) {
+        data.resize((size_t)chunkWidth * chunkHeight * chunkWidth);
+        size_t i = 0;
+        
+        for (int x = 0; x < chunkWidth; x++) {
+            for (int y = 0; y < chunkHeight; y++) {
+                const float* row = density.Row(x, y);
+                for (int z = 0; z < chunkWidth; z++) data[i++] = floatToHalf(row[z]);
+            }
+        }
+    }
+    else if (mode == DensityRetention::Compressed) {
+        // Runs go to scratch first so data is sized exactly once.
+        ScratchLease scratch;
+        std::vector<uint16_t>& runs = scratch->packedDensity;
+        runs.clear();
+        reserveScratch(runs, 0, ScratchArena::largestPackedDensity);
+        columnStart.resize(chunkWidth * chunkWidth);
+        
+        for (int column = 0; column < chunkWidth * chunkWidth; column++) {
+            columnStart[column] = (uint32_t)runs.size();
+            int x = column / chunkWidth, z = column % chunkWidth;
+            
+            uint16_t run = 0, value = 0;
+            for (int y = 0; y < chunkHeight; y++) {
+                // A dropped section packs at the band edge, joining the saturated runs around it.
+                int section = y / sectionSize;
+                float d = density.Present(section) ? glm::clamp(density.At(x, y, z), -compressedDensityBand, compressedDensityBand)
+                                                   : density.Solid(section) ? -compressedDensityBand : compressedDensityBand;
+                uint16_t half = floatToHalf(d);
+                
+                if (run > 0 && half == value) {
+                    run++;
+                    continue;
+                }
+                if (run > 0) {
+                    runs.push_back(run);
+                    runs.push_back(value);
+                }
+                run = 1;
+                value = half;
+            }
+            runs.push_back(run);
+            runs.push_back(value);
+        }
+        reserveScratch(runs, runs.size(), ScratchArena::largestPackedDensity);
+        data.assign(runs.begin(), runs.end());
+    }
+}
+
+bool PackedDensity::Unpack(DensityField& density) const {
+    if (mode != DensityRetention::Half && mode != DensityRetention::Compressed) return false;
+    density.Allocate();
+    
+    if (mode == DensityRetention::Half) {
+        size_t i = 0;
+        for (int x = 0; x < chunkWidth; x++) {
+            for (int y = 0; y < chunkHeight; y++) {
+                float* row = density.WritableRow(x, y);
+                for (int z = 0; z < chunkWidth; z++) row[z] = halfToFloat(data[i++]);
+            }
+        }
+    }
+    else {
+        for (int column = 0; column < chunkWidth * chunkWidth; column++) {
+            int x = column / chunkWidth, z = column % chunkWidth;
+            int y = 0;
+            
+            for (uint32_t i = columnStart[column]; y < chunkHeight; i += 2) {
+                float value = halfToFloat(data[i + 1]);
+                for (int r = 0; r < data[i]; r++, y++) density.WritableAt(x, y, z) = value;
+            }
+        }
+    }
+    
+    for (int s = 0; s < chunkSections; s++) {
+        if (droppedSections >> s & 1) density.Drop(s, density.At(0, s * sectionSize, 0) < 0.0f);
+    }
+    return true;
+}
+
+// Back to holding nothing, keeping the room for the next Pack.
+void PackedDensity::Reset() {
+    mode = DensityRetention::Discard;
+    data.clear();
+    columnStart.clear();
+    droppedSections = 0;
+}
+
+size_t PackedDensity::MemoryBytes() const {
+    return data.capacity() * sizeof(uint16_t) + columnStart.capacity() * sizeof(uint32_t);
+}
+
+#endif /* densityCodec_h */
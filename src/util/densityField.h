@@ -0,0 +1,158 @@
+//
+//  densityField.h
+//  Marching Cube Terrain
+//
+//  Created by Dmitri Wamback on 2026-10-16.
+//
+
+#ifndef densityField_h
+#define densityField_h
+
+#include <mutex>
+
+// A chunk's density field, chunkWidth x chunkHeight x chunkWidth points held
+// as chunkSections vertical sections of sectionSize rows, each laid out x, y, z.
+// A section that is all air or all solid can be dropped: it takes no storage
+// and reads back as +1 (air) or -1 (solid) everywhere until Restore gives it
+// storage again. Only Terrain::SampleDensity drops sections, and only ones
+// the mesher never reads a value from, so a dropped section always stands for
+// unedited noise and can be resampled.
+class DensityField {
+public:
+    bool Empty() const { return !allocated; }
+    bool Present(int section) const { return !sections[section].empty(); }
+    bool Solid(int section) const { return solid[section]; }
+    
+    void Allocate();
+    void Clear();
+    void Drop(int section, bool solid);
+    void Restore(int section);
+    uint32_t DroppedMask() const;
+    int Stored() const;
+    size_t MemoryBytes() const;
+    
+    float At(int x, int y, int z) const {
+        return Row(x, y)[z];
+    }
+    
+    const float* Row(int x, int y) const {
+        const std::vector<float>& section = sections[y / sectionSize];
+        return section.empty() ? FillRow(solid[y / sectionSize]) : &section[Offset(x, y)];
+    }
+    
+    // Writes need the section present.
+    float& WritableAt(int x, int y, int z) {
+        return sections[y / sectionSize][Offset(x, y) + z];
+    }
+    
+    float* WritableRow(int x, int y) {
+        return &sections[y / sectionSize][Offset(x, y)];
+    }
+private:
+    static const int sectionPoints = chunkWidth * sectionSize * chunkWidth;
+    
+    static int Offset(int x, int y) {
+        return (x * sectionSize + y % sectionSize) * chunkWidth;
+    }
+    
+    static const float* FillRow(bool solid);
+    
+    void Release(int section);
+    
+    std::array<std::vector<float>, chunkSections> sections;
+    std::array<bool, chunkSections> solid = {};
+    bool allocated = false;
+};
+
+// Section buffers no field is using, shared by every thread: Drop and Clear
+// give them back and Allocate and Restore take them, so sampling chunk after
+// chunk doesn't touch the heap. It never holds more sections than were once
+// in use at the same time.
+class SectionPool {
+public:
+    std::vector<float> Take() {
+        std::lock_guard<std::mutex> lock(mutex);
+        if (spare.empty()) return {};
+        
+        std::vector<float> section = std::move(spare.back());
+        spare.pop_back();
+        return section;
+    }
+    
+    void Give(std::vector<float>& section) {
+        std::lock_guard<std::mutex> lock(mutex);
+        spare.push_back(std::move(section));
+    }
+private:
+    std::mutex mutex;
+    std::vector<std::vector<float>> spare;
+};
+
+SectionPool sectionPool;
+
+const float* DensityField::FillRow(bool solid) {
+    static const std::array<std::array<float, chunkWidth>, 2> rows = [] {
+        std::array<std::array<float, chunkWidth>, 2> fill;
+        fill[0].fill(1.0f);
+        fill[1].fill(-1.0f);
+        return fill;
+    }();
+    return rows[solid].data();
+}
+
+void DensityField::Allocate() {
+    for (int s = 0; s < chunkSections; s++) {
+        if (Present(s)) std::fill(sections[s].begin(), sections[s].end(), 0.0f);
+        else Restore(s);
+    }
+    solid = {};
+    allocated = true;
+}
+
+void DensityField::Clear() {
+    for (int s = 0; s < chunkSections; s++) Release(s);
+    solid = {};
+    allocated = false;
+}
+
+void DensityField::Drop(int section, bool solid) {
+    Release(section);
+    this->solid[section] = solid;
+}
+
+// The section comes back zeroed; the caller fills it.
+void DensityField::Restore(int section) {
+    if (Present(section)) return;
+    
+    sections[section] = sectionPool.Take();
+    sections[section].assign(sectionPoints, 0.0f);
+}
+
+void DensityField::Release(int section) {
+    if (!Present(section)) return;
+    
+    sectionPool.Give(sections[section]);
+    sections[section] = {};
+}
+
+uint32_t DensityField::DroppedMask() const {
+    uint32_t mask = 0;
+    for (int s = 0; s < chunkSections; s++) {
+        if (allocated && !Present(s)) mask |= 1u << s;
+    }
+    return mask;
+}
+
+int DensityField::Stored() const {
+    int stored = 0;
+    for (int s = 0; s < chunkSections; s++) stored += Present(s);
+    return stored;
+}
+
+size_t DensityField::MemoryBytes() const {
+    size_t bytes = 0;
+    for (const std::vector<float>& section : sections) bytes += section.capacity() * sizeof(float);
+    return bytes;
+}
+
+#endif /* densityField_h */
@@ -0,0 +1,590 @@
+//
+//  densityGraph.h
+//  Marching Cube Terrain
+//
+//  Created by Dmitri Wamback on 2026-10-16.
+//
+
+#ifndef densityGraph_h
+#define densityGraph_h
+
+// The density function as a small graph of named layers, read from text with
+// one node per line:
+//
+//     name = op arg arg ...     # comment
+//
+//     fbm2 scale lacunarity persistence octaves   noise over x, z (seed as the third axis)
+//     fbm3 scale lacunarity persistence octaves   noise over x, y, z
+//     add a b, sub a b, mul a b, min a b, max a b
+//     clamp a low high                            glm::clamp(a, low, high)
+//     floor a height value                        value where y < height, else a
+//
+// Arguments are earlier node names, numbers, or y (the voxel's height in
+// lattice units). The node named density is the result.
+//
+// Compile splits it into two straight-line programs. Nodes that don't depend
+// on y run once per column and are cached with the heightfield tiles; the rest
+// run per block of voxel rows, each instruction looping over the whole block,
+// so there is no per-voxel dispatch.
+//
+// EvaluateRowsBounded adds fbm3 octaves a few at a time and carries a [low,
+// high] interval through the voxel stage, from what the octaves left out could
+// still add. A row stops as soon as every voxel in it is decided to be on one
+// side of the isolevel; only its sign is exact after that.
+
+enum class DensityOp : uint8_t {
+    Constant,
+    Y,
+    Column,
+    Fbm2,
+    Fbm3,
+    Add,
+    Sub,
+    Mul,
+    Min,
+    Max,
+    Clamp,
+    Floor
+};
+
+struct DensityInstruction {
+    DensityOp op;
+    int out = 0, a = 0, b = 0, c = 0;
+    float value = 0.0f;
+    double lacunarity = 0.0, persistence = 0.0;
+    int octaves = 0;
+};
+
+// A block of rows along z stacked in y: the shared noise-space x, noise-space
+// y and lattice height per row, noise-space z per lane, and the column channels
+// (maxLanes floats each). Results come out row after row.
+struct DensityRows {
+    float x;
+    const float* y;
+    const float* height;
+    const float* z;
+    const float* columns;
+    int count, rows;
+};
+
+class DensityProgram {
+public:
+    static const int maxLanes = chunkWidth / 2 > 16 ? chunkWidth / 2 : 16;
+    static const int maxRows = 8;
+    static const int blockLanes = maxLanes * maxRows;
+    static const int maxRegisters = 64;
+    static const int octaveStep = 2;
+    
+    std::vector<DensityInstruction> columnCode, voxelCode;
+    std::vector<int> channelRegisters;
+    std::vector<float> constants;
+    int output = 0;
+    
+    bool Empty() const { return voxelCode.empty(); }
+    int Channels() const { return (int)channelRegisters.size(); }
+    int VoxelOctaves() const;
+    uint64_t Hash() const;
+    
+    static bool Compile(const std::string& source, DensityProgram& program, std::string& error);
+    static bool Load(const std::string& path, DensityProgram& program, std::string& error);
+    
+    void EvaluateColumn(float x, float z, float* channels) const;
+    void EvaluateRows(const DensityRows& rows, float* out) const;
+    int EvaluateRowsBounded(const DensityRows& rows, float isolevel, float* out, bool* culled) const;
+};
+
+// Set by --graph; empty means the built-in formula from TerrainParameters.
+DensityProgram densityGraph;
+
+bool DensityProgram::Compile(const std::string& source, DensityProgram& program, std::string& error) {
+    struct Node {
+        DensityOp op;
+        std::vector<int> inputs;
+        DensityInstruction instruction;
+        bool voxel = false;
+        bool used = false;
+        int columnRegister = -1, voxelRegister = -1;
+    };
+    
+    std::vector<Node> nodes;
+    std::unordered_map<std::string, int> names;
+    
+    const std::pair<const char*, DensityOp> ops[] = {
+        {"fbm2", DensityOp::Fbm2}, {"fbm3", DensityOp::Fbm3}, {"add", DensityOp::Add}, {"sub", DensityOp::Sub},
+        {"mul", DensityOp::Mul}, {"min", DensityOp::Min}, {"max", DensityOp::Max}, {"clamp", DensityOp::Clamp},
+        {"floor", DensityOp::Floor}
+    };
+    
+    auto constant = [&](float value) {
+        Node node;
+        node.op = DensityOp::Constant;
+        node.instruction.value = value;
+        nodes.push_back(node);
+        return (int)nodes.size() - 1;
+    };
+    
+    int y = -1;
+    std::istringstream lines(source);
+    std::string line;
+    int lineNumber = 0;
+    
+    while (std::getline(lines, line)) {
+        lineNumber++;
+        std::istringstream words(line.substr(0, line.find('#')));
+        std::string name, equals, opName;
+        if (!(words >> name)) continue;
+        
+        auto fail = [&](const std::string& message) {
+            error = "line " + std::to_string(lineNumber) + ": " + message;
+            return false;
+        };
+        
+        if (!(words >> equals >> opName) || equals != "=") return fail("expected 'name = op args'");
+        if (name == "y" || names.count(name)) return fail("'" + name + "' is already defined");
+        
+        Node node;
+        auto op = std::find_if(std::begin(ops), std::end(ops), [&](auto& entry) { return opName == entry.first; });
+        if (op == std::end(ops)) return fail("unknown op '" + opName + "'");
+        node.op = op->second;
+        
+        std::vector<std::string> args;
+        for (std::string arg; words >> arg;) args.push_back(arg);
+        
+        if (node.op == DensityOp::Fbm2 || node.op == DensityOp::Fbm3) {
+            if (args.size() != 4) return fail(opName + " takes scale, lacunarity, persistence and octaves");
+            try {
+                node.instruction.value = std::stof(args[0]);
+                node.instruction.lacunarity = std::stod(args[1]);
+                node.instruction.persistence = std::stod(args[2]);
+                node.instruction.octaves = std::stoi(args[3]);
+            }
+            catch (const std::exception&) {
+                return fail(opName + " arguments must be numbers");
+            }
+            node.voxel = node.op == DensityOp::Fbm3;
+        }
+        else {
+            size_t arity = node.op == DensityOp::Clamp || node.op == DensityOp::Floor ? 3 : 2;
+            if (args.size() != arity) return fail(opName + " takes " + std::to_string(arity) + " arguments");
+            
+            for (const std::string& arg : args) {
+                int input;
+                if (arg == "y") {
+                    if (y < 0) {
+                        Node height;
+                        height.op = DensityOp::Y;
+                        height.voxel = true;
+                        nodes.push_back(height);
+                        y = (int)nodes.size() - 1;
+                    }
+                    input = y;
+                }
+                else if (names.count(arg)) {
+                    input = names[arg];
+                }
+                else {
+                    char* end;
+                    float value = std::strtof(arg.c_str(), &end);
+                    if (*end || end == arg.c_str()) return fail("unknown node '" + arg + "'");
+                    input = constant(value);
+                }
+                node.inputs.push_back(input);
+                node.voxel |= nodes[input].voxel;
+            }
+            if (node.op == DensityOp::Floor) node.voxel = true;
+        }
+        
+        nodes.push_back(node);
+        names[name] = (int)nodes.size() - 1;
+    }
+    
+    if (!names.count("density")) {
+        error = "no node named density";
+        return false;
+    }
+    
+    // Walk back from the result; nodes are defined before use, so marking in
+    // reverse order reaches every input.
+    int result = names["density"];
+    nodes[result].used = true;
+    for (int i = result; i >= 0; i--) {
+        if (!nodes[i].used) continue;
+        for (int input : nodes[i].inputs) nodes[input].used = true;
+    }
+    
+    program = DensityProgram();
+    int columnRegisters = 0, voxelRegisters = 0;
+    
+    auto emit = [](std::vector<DensityInstruction>& code, const Node& node, int out, std::initializer_list<int> inputs) {
+        DensityInstruction instruction = node.instruction;
+        instruction.op = node.op;
+        instruction.out = out;
+        int* operands[3] = {&instruction.a, &instruction.b, &instruction.c};
+        int i = 0;
+        for (int input : inputs) *operands[i++] = input;
+        code.push_back(instruction);
+    };
+    
+    for (Node& node : nodes) {
+        if (!node.used || node.voxel) continue;
+        node.columnRegister = columnRegisters++;
+        std::vector<int> inputs;
+        for (int input : node.inputs) inputs.push_back(nodes[input].columnRegister);
+        emit(program.columnCode, node, node.columnRegister,
+             {inputs.size() > 0 ? inputs[0] : 0, inputs.size() > 1 ? inputs[1] : 0, inputs.size() > 2 ? inputs[2] : 0});
+    }
+    
+    // A column value the voxel stage reads becomes a channel, read straight
+    // from the row; constants get a row of their own.
+    auto voxelInput = [&](int index) {
+        Node& input = nodes[index];
+        if (input.voxelRegister >= 0) return input.voxelRegister;
+        
+        input.voxelRegister = voxelRegisters++;
+        if (input.op == DensityOp::Constant) {
+            emit(program.voxelCode, input, input.voxelRegister, {(int)program.constants.size() / blockLanes});
+            program.constants.insert(program.constants.end(), blockLanes, input.instruction.value);
+            return input.voxelRegister;
+        }
+        
+        DensityInstruction load;
+        load.op = DensityOp::Column;
+        load.out = input.voxelRegister;
+        load.a = (int)program.channelRegisters.size();
+        program.channelRegisters.push_back(input.columnRegister);
+        program.voxelCode.push_back(load);
+        return input.voxelRegister;
+    };
+    
+    for (int i = 0; i < (int)nodes.size(); i++) {
+        Node& node = nodes[i];
+        if (!node.used || !node.voxel) continue;
+        
+        std::vector<int> inputs;
+        for (int input : node.inputs) inputs.push_back(voxelInput(input));
+        node.voxelRegister = voxelRegisters++;
+        emit(program.voxelCode, node, node.voxelRegister,
+             {inputs.size() > 0 ? inputs[0] : 0, inputs.size() > 1 ? inputs[1] : 0, inputs.size() > 2 ? inputs[2] : 0});
+    }
+    program.output = voxelInput(result);
+    
+    if (columnRegisters > maxRegisters || voxelRegisters > maxRegisters) {
+        error = "more than " + std::to_string(maxRegisters) + " nodes in one stage";
+        return false;
+    }
+    return true;
+}
+
+bool DensityProgram::Load(const std::string& path, DensityProgram& program, std::string& error) {
+    std::ifstream file(path);
+    if (!file) {
+        error = "could not open " + path;
+        return false;
+    }
+    std::stringstream source;
+    source << file.rdbuf();
+    
+    if (!Compile(source.str(), program, error)) {
+        error = path + ": " + error;
+        return false;
+    }
+    return true;
+}
+
+uint64_t DensityProgram::Hash() const {
+    uint64_t hash = fnvOffset;
+    for (const std::vector<DensityInstruction>* code : {&columnCode, &voxelCode}) {
+        for (const DensityInstruction& instruction : *code) {
+            hash = fnv1a(instruction.op, hash);
+            hash = fnv1a(instruction.out, hash);
+            hash = fnv1a(instruction.a, hash);
+            hash = fnv1a(instruction.b, hash);
+            hash = fnv1a(instruction.c, hash);
+            hash = fnv1a(instruction.value, hash);
+            hash = fnv1a(instruction.lacunarity, hash);
+            hash = fnv1a(instruction.persistence, hash);
+            hash = fnv1a(instruction.octaves, hash);
+        }
+        hash = fnv1a(code->size(), hash);
+    }
+    for (int channel : channelRegisters) hash = fnv1a(channel, hash);
+    return fnv1a(output, hash);
+}
+
+// fbm3 octaves a full evaluation runs per voxel.
+int DensityProgram::VoxelOctaves() const {
+    int octaves = 0;
+    for (const DensityInstruction& instruction : voxelCode) {
+        if (instruction.op == DensityOp::Fbm3) octaves += instruction.octaves;
+    }
+    return octaves;
+}
+
+void DensityProgram::EvaluateColumn(float x, float z, float* channels) const {
+    float registers[maxRegisters];
+    
+    for (const DensityInstruction& instruction : columnCode) {
+        const float* r = registers;
+        float& out = registers[instruction.out];
+        
+        switch (instruction.op) {
+            case DensityOp::Constant: out = instruction.value; break;
+            case DensityOp::Fbm2:
+                out = noiseLayer(x * instruction.value, z * instruction.value, instruction.lacunarity, instruction.persistence, instruction.octaves, seed);
+                break;
+            case DensityOp::Add:   out = r[instruction.a] + r[instruction.b]; break;
+            case DensityOp::Sub:   out = r[instruction.a] - r[instruction.b]; break;
+            case DensityOp::Mul:   out = r[instruction.a] * r[instruction.b]; break;
+            case DensityOp::Min:   out = std::min(r[instruction.a], r[instruction.b]); break;
+            case DensityOp::Max:   out = std::max(r[instruction.a], r[instruction.b]); break;
+            case DensityOp::Clamp: out = glm::clamp(r[instruction.a], r[instruction.b], r[instruction.c]); break;
+            default: break;
+        }
+    }
+    
+    for (int i = 0; i < Channels(); i++) channels[i] = registers[channelRegisters[i]];
+}
+
+// Registers are pointers, so constants are read where they are instead of
+// being copied in for every block.
+void DensityProgram::EvaluateRows(const DensityRows& rows, float* out) const {
+    float storage[maxRegisters][blockLanes];
+    const float* registers[maxRegisters] = {};
+    const int count = rows.count;
+    const int lanes = count * rows.rows;
+    
+    for (const DensityInstruction& instruction : voxelCode) {
+        const float* a = registers[instruction.a];
+        const float* b = registers[instruction.b];
+        const float* c = registers[instruction.c];
+        float* result = storage[instruction.out];
+        registers[instruction.out] = result;
+        
+        switch (instruction.op) {
+            case DensityOp::Constant:
+                registers[instruction.out] = &constants[instruction.a * blockLanes];
+                break;
+            case DensityOp::Y:
+                for (int r = 0; r < rows.rows; r++) {
+                    for (int i = 0; i < count; i++) result[r * count + i] = rows.height[r];
+                }
+                break;
+            case DensityOp::Column:
+                for (int r = 0; r < rows.rows; r++) {
+                    for (int i = 0; i < count; i++) result[r * count + i] = rows.columns[instruction.a * maxLanes + i];
+                }
+                break;
+            case DensityOp::Fbm3: {
+                float z[maxLanes];
+                for (int i = 0; i < count; i++) z[i] = rows.z[i] * instruction.value;
+                for (int r = 0; r < rows.rows; r++) {
+                    noiseLayerRow(rows.x * instruction.value, rows.y[r] * instruction.value, z, result + r * count, count,
+                                  instruction.lacunarity, instruction.persistence, instruction.octaves);
+                }
+                break;
+            }
+            case DensityOp::Add:
+                for (int i = 0; i < lanes; i++) result[i] = a[i] + b[i];
+                break;
+            case DensityOp::Sub:
+                for (int i = 0; i < lanes; i++) result[i] = a[i] - b[i];
+                break;
+            case DensityOp::Mul:
+                for (int i = 0; i < lanes; i++) result[i] = a[i] * b[i];
+                break;
+            case DensityOp::Min:
+                for (int i = 0; i < lanes; i++) result[i] = std::min(a[i], b[i]);
+                break;
+            case DensityOp::Max:
+                for (int i = 0; i < lanes; i++) result[i] = std::max(a[i], b[i]);
+                break;
+            case DensityOp::Clamp:
+                for (int i = 0; i < lanes; i++) result[i] = glm::clamp(a[i], b[i], c[i]);
+                break;
+            case DensityOp::Floor:
+                for (int r = 0; r < rows.rows; r++) {
+                    for (int i = 0; i < count; i++) {
+                        int lane = r * count + i;
+                        result[lane] = rows.height[r] < b[lane] ? c[lane] : a[lane];
+                    }
+                }
+                break;
+            default:
+                break;
+        }
+    }
+    
+    const float* result = registers[output];
+    for (int i = 0; i < lanes; i++) out[i] = result[i];
+}
+
+// Returns the fbm3 octaves evaluated, summed over voxels. culled[r] is set for
+// rows that stopped early. Rows that can't be resumed bit-identically (see
+// noiseRowResumable) are evaluated in full.
+int DensityProgram::EvaluateRowsBounded(const DensityRows& rows, float isolevel, float* out, bool* culled) const {
+    const int count = rows.count;
+    const int lanes = count * rows.rows;
+    
+    int fullOctaves = VoxelOctaves(), deepest = 0;
+    for (const DensityInstruction& instruction : voxelCode) {
+        if (instruction.op == DensityOp::Fbm3) deepest = std::max(deepest, instruction.octaves);
+    }
+    
+    if (!noiseRowResumable(count) || !fullOctaves) {
+        EvaluateRows(rows, out);
+        for (int r = 0; r < rows.rows; r++) culled[r] = false;
+        return fullOctaves * lanes;
+    }
+    
+    // sums holds each fbm3 node's octaves so far, in its output register.
+    float sums[maxRegisters][blockLanes];
+    float lowStorage[maxRegisters][blockLanes], highStorage[maxRegisters][blockLanes];
+    const float* low[maxRegisters] = {};
+    const float* high[maxRegisters] = {};
+    
+    int level[maxRows];
+    bool open[maxRows];
+    for (int r = 0; r < rows.rows; r++) {
+        level[r] = 0;
+        open[r] = true;
+    }
+    for (const DensityInstruction& instruction : voxelCode) {
+        if (instruction.op == DensityOp::Fbm3) std::fill(sums[instruction.out], sums[instruction.out] + lanes, 0.0f);
+    }
+    
+    int evaluated = 0;
+    
+    while (true) {
+        for (const DensityInstruction& instruction : voxelCode) {
+            const float *aLow = low[instruction.a], *aHigh = high[instruction.a];
+            const float *bLow = low[instruction.b], *bHigh = high[instruction.b];
+            const float *cLow = low[instruction.c], *cHigh = high[instruction.c];
+            float* resultLow = lowStorage[instruction.out];
+            float* resultHigh = highStorage[instruction.out];
+            low[instruction.out] = resultLow;
+            high[instruction.out] = resultHigh;
+            
+            switch (instruction.op) {
+                case DensityOp::Constant:
+                    low[instruction.out] = high[instruction.out] = &constants[instruction.a * blockLanes];
+                    break;
+                case DensityOp::Y:
+                    for (int r = 0; r < rows.rows; r++) {
+                        for (int i = 0; i < count; i++) resultLow[r * count + i] = rows.height[r];
+                    }
+                    high[instruction.out] = resultLow;
+                    break;
+                case DensityOp::Column:
+                    for (int r = 0; r < rows.rows; r++) {
+                        for (int i = 0; i < count; i++) resultLow[r * count + i] = rows.columns[instruction.a * maxLanes + i];
+                    }
+                    high[instruction.out] = resultLow;
+                    break;
+                case DensityOp::Fbm3:
+                    for (int r = 0; r < rows.rows; r++) {
+                        float remaining = (float)noiseLayerRemaining(instruction.persistence, level[r], instruction.octaves);
+                        for (int i = r * count; i < (r + 1) * count; i++) {
+                            resultLow[i] = sums[instruction.out][i] - remaining;
+                            resultHigh[i] = sums[instruction.out][i] + remaining;
+                        }
+                    }
+                    break;
+                case DensityOp::Add:
+                    for (int i = 0; i < lanes; i++) {
+                        resultLow[i] = aLow[i] + bLow[i];
+                        resultHigh[i] = aHigh[i] + bHigh[i];
+                    }
+                    break;
+                case DensityOp::Sub:
+                    for (int i = 0; i < lanes; i++) {
+                        resultLow[i] = aLow[i] - bHigh[i];
+                        resultHigh[i] = aHigh[i] - bLow[i];
+                    }
+                    break;
+                case DensityOp::Mul:
+                    for (int i = 0; i < lanes; i++) {
+                        float p0 = aLow[i] * bLow[i], p1 = aLow[i] * bHigh[i], p2 = aHigh[i] * bLow[i], p3 = aHigh[i] * bHigh[i];
+                        resultLow[i] = std::min(std::min(p0, p1), std::min(p2, p3));
+                        resultHigh[i] = std::max(std::max(p0, p1), std::max(p2, p3));
+                    }
+                    break;
+                case DensityOp::Min:
+                    for (int i = 0; i < lanes; i++) {
+                        resultLow[i] = std::min(aLow[i], bLow[i]);
+                        resultHigh[i] = std::min(aHigh[i], bHigh[i]);
+                    }
+                    break;
+                case DensityOp::Max:
+                    for (int i = 0; i < lanes; i++) {
+                        resultLow[i] = std::max(aLow[i], bLow[i]);
+                        resultHigh[i] = std::max(aHigh[i], bHigh[i]);
+                    }
+                    break;
+                case DensityOp::Clamp:
+                    for (int i = 0; i < lanes; i++) {
+                        resultLow[i] = glm::clamp(aLow[i], bLow[i], cLow[i]);
+                        resultHigh[i] = glm::clamp(aHigh[i], bHigh[i], cHigh[i]);
+                    }
+                    break;
+                case DensityOp::Floor:
+                    for (int r = 0; r < rows.rows; r++) {
+                        for (int i = r * count; i < (r + 1) * count; i++) {
+                            bool below = rows.height[r] < bLow[i], belowAll = rows.height[r] < bHigh[i];
+                            resultLow[i] = below ? cLow[i] : belowAll ? std::min(aLow[i], cLow[i]) : aLow[i];
+                            resultHigh[i] = below ? cHigh[i] : belowAll ? std::max(aHigh[i], cHigh[i]) : aHigh[i];
+                        }
+                    }
+                    break;
+                default:
+                    break;
+            }
+        }
+        
+        // A row is finished once all its voxels are decided or it has every octave.
+        bool any = false;
+        for (int r = 0; r < rows.rows; r++) {
+            if (!open[r]) continue;
+            
+            bool complete = level[r] >= deepest;
+            bool decided = true;
+            for (int i = r * count; i < (r + 1) * count && decided; i++) {
+                decided = low[output][i] >= isolevel || high[output][i] < isolevel;
+            }
+            if (!complete && !decided) {
+                any = true;
+                continue;
+            }
+            
+            for (int i = r * count; i < (r + 1) * count; i++) {
+                out[i] = complete ? low[output][i] : (low[output][i] + high[output][i]) * 0.5f;
+            }
+            culled[r] = !complete;
+            open[r] = false;
+        }
+        if (!any) break;
+        
+        for (const DensityInstruction& instruction : voxelCode) {
+            if (instruction.op != DensityOp::Fbm3) continue;
+            
+            float z[maxLanes];
+            for (int i = 0; i < count; i++) z[i] = rows.z[i] * instruction.value;
+            
+            for (int r = 0; r < rows.rows; r++) {
+                if (!open[r]) continue;
+                int first = std::min(level[r], instruction.octaves);
+                int last = std::min(level[r] + octaveStep, instruction.octaves);
+                if (first == last) continue;
+                
+                noiseLayerRowOctaves(rows.x * instruction.value, rows.y[r] * instruction.value, z, sums[instruction.out] + r * count, count,
+                                     instruction.lacunarity, instruction.persistence, first, last);
+                evaluated += (last - first) * count;
+            }
+        }
+        for (int r = 0; r < rows.rows; r++) {
+            if (open[r]) level[r] += octaveStep;
+        }
+    }
+    return evaluated;
+}
+
+#endif /* densityGraph_h */
@@ -0,0 +1,58 @@
+//
+//  densitySigns.h
+//  Marching Cube Terrain
+//
+//  Created by Dmitri Wamback on 2026-10-16.
+//
+
+#ifndef densitySigns_h
+#define densitySigns_h
+
+// Sign bits of one 16-point z row of the density field: bit z is set where
+// row[z] < isolevel, the same test the cube classification makes per corner.
+// Two AVX2 or four SSE compares and movemasks, on the ISA picked for noise.
+
+#if NOISE_SIMD_X86
+
+NOISE_TARGET_AVX2
+static uint16_t densitySignsAVX2(const float* row, float isolevel) {
+    __m256 level = _mm256_set1_ps(isolevel);
+    int low = _mm256_movemask_ps(_mm256_cmp_ps(_mm256_loadu_ps(row), level, _CMP_LT_OQ));
+    int high = _mm256_movemask_ps(_mm256_cmp_ps(_mm256_loadu_ps(row + 8), level, _CMP_LT_OQ));
+    return (uint16_t)(low | high << 8);
+}
+
+NOISE_TARGET_SSE41
+static uint16_t densitySignsSSE41(const float* row, float isolevel) {
+    __m128 level = _mm_set1_ps(isolevel);
+    int signs = 0;
+    for (int i = 0; i < 4; i++) {
+        signs |= _mm_movemask_ps(_mm_cmplt_ps(_mm_loadu_ps(row + i * 4), level)) << (i * 4);
+    }
+    return (uint16_t)signs;
+}
+
+#endif
+
+inline uint16_t densitySigns(const float* row, float isolevel) {
+#if NOISE_SIMD_X86
+    if (noiseIsa == NoiseIsa::AVX2) return densitySignsAVX2(row, isolevel);
+    if (noiseIsa == NoiseIsa::SSE41) return densitySignsSSE41(row, isolevel);
+#endif
+    uint16_t signs = 0;
+    for (int z = 0; z < 16; z++) {
+        if (row[z] < isolevel) signs |= 1 << z;
+    }
+    return signs;
+}
+
+// Sign bits of a whole chunk row, 16 points at a time.
+inline RowMask rowSigns(const float* row, float isolevel) {
+    if constexpr (chunkWidth == 16) return densitySigns(row, isolevel);
+    
+    RowMask signs = 0;
+    for (int z = 0; z < chunkWidth; z += 16) signs |= (RowMask)densitySigns(row + z, isolevel) << z;
+    return signs;
+}
+
+#endif /* densitySigns_h */
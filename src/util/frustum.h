@@ -0,0 +1,69 @@
+//
+//  frustum.h
+//  Marching Cube Terrain
+//
+//  Created by Dmitri Wamback on 2026-10-16.
+//
+
+#ifndef frustum_h
+#define frustum_h
+
+struct AABB {
+    glm::vec3 min = glm::vec3(INFINITY);
+    glm::vec3 max = glm::vec3(-INFINITY);
+    
+    void Expand(glm::vec3 point) {
+        min = glm::min(min, point);
+        max = glm::max(max, point);
+    }
+    
+    bool Empty() const {
+        return min.x > max.x;
+    }
+};
+
+// Six planes (left, right, bottom, top, near, far) pulled out of a
+// projection * view matrix, normals pointing inwards.
+struct Frustum {
+    glm::vec4 planes[6];
+    
+    static Frustum FromMatrix(const glm::mat4& viewProjection);
+    bool Intersects(const AABB& box) const;
+};
+
+Frustum Frustum::FromMatrix(const glm::mat4& m) {
+    Frustum frustum;
+    
+    // glm is column-major, so row i of the matrix is (m[0][i], m[1][i], m[2][i], m[3][i]).
+    glm::vec4 row[4];
+    for (int i = 0; i < 4; i++) row[i] = glm::vec4(m[0][i], m[1][i], m[2][i], m[3][i]);
+    
+    frustum.planes[0] = row[3] + row[0];
+    frustum.planes[1] = row[3] - row[0];
+    frustum.planes[2] = row[3] + row[1];
+    frustum.planes[3] = row[3] - row[1];
+    frustum.planes[4] = row[3] + row[2];
+    frustum.planes[5] = row[3] - row[2];
+    
+    for (glm::vec4& plane : frustum.planes) {
+        plane = plane / glm::length(glm::vec3(plane.x, plane.y, plane.z));
+    }
+    return frustum;
+}
+
+// Conservative: a box is only rejected when it lies entirely behind one
+// plane, tested with the corner furthest along that plane's normal.
+bool Frustum::Intersects(const AABB& box) const {
+    if (box.Empty()) return false;
+    
+    for (const glm::vec4& plane : planes) {
+        glm::vec3 corner = glm::vec3(plane.x >= 0.0f ? box.max.x : box.min.x,
+                                     plane.y >= 0.0f ? box.max.y : box.min.y,
+                                     plane.z >= 0.0f ? box.max.z : box.min.z);
+        
+        if (plane.x * corner.x + plane.y * corner.y + plane.z * corner.z + plane.w < 0.0f) return false;
+    }
+    return true;
+}
+
+#endif /* frustum_h */
@@ -0,0 +1,28 @@
+//
+//  hash.h
+//  Marching Cube Terrain
+//
+//  Created by Dmitri Wamback on 2026-10-16.
+//
+
+#ifndef hash_h
+#define hash_h
+
+// 64-bit FNV-1a, used for parameter fingerprints and mesh checksums.
+const uint64_t fnvOffset = 14695981039346656037ull;
+
+uint64_t fnv1a(const void* data, size_t size, uint64_t hash = fnvOffset) {
+    const uint8_t* bytes = static_cast<const uint8_t*>(data);
+    for (size_t i = 0; i < size; i++) {
+        hash ^= bytes[i];
+        hash *= 1099511628211ull;
+    }
+    return hash;
+}
+
+template<typename T>
+uint64_t fnv1a(const T& value, uint64_t hash) {
+    return fnv1a(&value, sizeof(T), hash);
+}
+
+#endif /* hash_h */
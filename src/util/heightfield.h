@@ -0,0 +1,180 @@
+//
+//  heightfield.h
+//  Marching Cube Terrain
+//
+//  Created by Dmitri Wamback on 2026-10-16.
+//
+
+#ifndef heightfield_h
+#define heightfield_h
+
+#include <mutex>
+#include <memory>
+#include <atomic>
+#include <unordered_map>
+#include <list>
+
+// Chunks are chunkWidth columns wide but start every chunkWidth / 2 columns,
+// so the 2D height layers and the density field are cached in tiles half a
+// chunk across (8x8 columns by default): a chunk reads
+// 2x2 tiles and every tile is shared by the four chunks that overlap it. The
+// height layers are whatever column channels the density graph produces.
+struct HeightfieldTile {
+    static const int size = chunkWidth / 2;
+    std::vector<float> channels;
+};
+
+// Density of a tile-wide column of the chunk at one level of detail; only every stride-th
+// lattice point is stored, in the same x, y, z order as the chunk field.
+struct DensityTile {
+    static const int size = chunkWidth / 2;
+    int stride = 1;
+    std::vector<float> density;
+    std::vector<uint8_t> culled;
+    
+    void Resize(int lod) {
+        stride = 1 << lod;
+        density.resize((size / stride) * (chunkHeight / stride) * (size / stride));
+        culled.assign((size / stride) * (chunkHeight / stride), 0);
+    }
+    
+    // Whether the z row at (x, y) stopped early under octaveCulling.
+    uint8_t& Culled(int x, int y) {
+        return culled[(x / stride) * (chunkHeight / stride) + y / stride];
+    }
+    
+    uint8_t Culled(int x, int y) const {
+        return culled[(x / stride) * (chunkHeight / stride) + y / stride];
+    }
+    
+    float& At(int x, int y, int z) {
+        return density[((x / stride) * (chunkHeight / stride) + y / stride) * (size / stride) + z / stride];
+    }
+    
+    float At(int x, int y, int z) const {
+        return density[((x / stride) * (chunkHeight / stride) + y / stride) * (size / stride) + z / stride];
+    }
+};
+
+// LRU of shared, immutable tiles keyed by tile coordinate and level. Once the
+// cache is full a miss reuses the evicted entry's map and list nodes, and
+// evicted tiles are kept to be refilled once no chunk holds them any more, so
+// a steady stream of misses doesn't allocate.
+template<typename Tile>
+class TileCache {
+public:
+    size_t capacity;
+    std::atomic<uint64_t> hits{0}, misses{0};
+    
+    TileCache(size_t capacity) : capacity(capacity) {
+        spare.reserve(maxSpare);
+    }
+    
+    template<typename Fill>
+    std::shared_ptr<const Tile> Get(int tileX, int tileZ, int level, uint64_t fingerprint, Fill fill);
+    void Clear();
+private:
+    struct Entry {
+        std::shared_ptr<const Tile> tile;
+        std::list<int64_t>::iterator age;
+    };
+    
+    static const size_t maxSpare = 16;
+    
+    static int64_t Key(int tileX, int tileZ, int level) {
+        return ((int64_t)tileX << 34) ^ ((int64_t)(uint32_t)tileZ << 2) ^ level;
+    }
+    
+    std::mutex mutex;
+    uint64_t cachedFingerprint = 0;
+    std::unordered_map<int64_t, Entry> tiles;
+    std::list<int64_t> recent;
+    std::vector<std::shared_ptr<Tile>> spare;
+};
+
+TileCache<HeightfieldTile> heightfieldCache(4096);
+TileCache<DensityTile> densityTileCache(512);
+
+// fingerprint identifies the seed and parameters; a new one flushes the cache.
+// fill must overwrite every value of a reused tile.
+template<typename Tile>
+template<typename Fill>
+std::shared_ptr<const Tile> TileCache<Tile>::Get(int tileX, int tileZ, int level, uint64_t fingerprint, Fill fill) {
+    int64_t key = Key(tileX, tileZ, level);
+    std::shared_ptr<Tile> tile;
+    {
+        std::lock_guard<std::mutex> lock(mutex);
+        
+        if (fingerprint != cachedFingerprint) {
+            tiles.clear();
+            recent.clear();
+            cachedFingerprint = fingerprint;
+        }
+        
+        auto found = tiles.find(key);
+        if (found != tiles.end()) {
+            recent.splice(recent.begin(), recent, found->second.age);
+            hits++;
+            return found->second.tile;
+        }
+        
+        for (size_t i = 0; i < spare.size(); i++) {
+            // Nothing can take a new reference to a spare tile, so a count of
+            // one means every chunk that read it has let go.
+            if (spare[i].use_count() != 1) continue;
+            std::atomic_thread_fence(std::memory_order_acquire);
+            
+            tile = std::move(spare[i]);
+            spare[i] = std::move(spare.back());
+            spare.pop_back();
+            break;
+        }
+    }
+    
+    // Filled outside the lock; if two chunks race for the same tile both compute
+    // identical values and the second insert is simply dropped.
+    if (!tile) tile = std::make_shared<Tile>();
+    fill(*tile);
+    misses++;
+    
+    std::lock_guard<std::mutex> lock(mutex);
+    if (fingerprint != cachedFingerprint || tiles.count(key) || capacity == 0) {
+        // The caller still reads it, but it can be refilled once it lets go.
+        if (spare.size() < maxSpare) spare.push_back(tile);
+        return tile;
+    }
+    
+    if (tiles.size() < capacity) {
+        tiles.reserve(capacity + 1);
+        recent.push_front(key);
+        tiles[key] = {tile, recent.begin()};
+        return tile;
+    }
+    
+    while (tiles.size() > capacity) {
+        tiles.erase(recent.back());
+        recent.pop_back();
+    }
+    
+    auto evicted = tiles.extract(recent.back());
+    if (spare.size() < maxSpare) spare.push_back(std::const_pointer_cast<Tile>(std::move(evicted.mapped().tile)));
+    
+    recent.splice(recent.begin(), recent, std::prev(recent.end()));
+    recent.front() = key;
+    evicted.key() = key;
+    evicted.mapped() = {tile, recent.begin()};
+    tiles.insert(std::move(evicted));
+    return tile;
+}
+
+template<typename Tile>
+void TileCache<Tile>::Clear() {
+    std::lock_guard<std::mutex> lock(mutex);
+    tiles.clear();
+    recent.clear();
+    spare.clear();
+    hits = 0;
+    misses = 0;
+}
+
+#endif /* heightfield_h */
@@ -0,0 +1,286 @@
+//
+//  jobSystem.h
+//  Marching Cube Terrain
+//
+//  Created by Dmitri Wamback on 2026-10-16.
+//
+
+#ifndef jobSystem_h
+#define jobSystem_h
+
+#include <thread>
+#include <mutex>
+#include <condition_variable>
+#include <memory>
+#include <atomic>
+#include <new>
+#include <type_traits>
+
+// Long-lived work-stealing pool. Each worker owns a deque: it pushes and pops at
+// the back and other threads steal from the front. A thread that waits on a
+// JobGroup runs queued jobs instead of blocking, so jobs may submit and wait on
+// nested jobs (a chunk job waiting on its density slices) without deadlocking.
+//
+// Initialize(n) spawns n - 1 workers; the thread that calls Wait is the n-th.
+// Jobs are stored inline in a ring per worker, so submitting doesn't allocate
+// unless a job captures more than JobFunction::inlineSize bytes.
+
+struct JobGroup {
+    std::atomic<int> pending{0};
+};
+
+thread_local int jobWorkerIndex = -1;
+
+// Move-only void() callable with room for small captures in place.
+class JobFunction {
+public:
+    static const size_t inlineSize = 128;
+    
+    JobFunction() = default;
+    
+    template<typename Function, typename = std::enable_if_t<!std::is_same_v<std::decay_t<Function>, JobFunction>>>
+    JobFunction(Function&& function);
+    
+    JobFunction(JobFunction&& other) noexcept;
+    JobFunction& operator=(JobFunction&& other) noexcept;
+    ~JobFunction();
+    
+    void operator()() {
+        invoke(storage);
+    }
+private:
+    alignas(std::max_align_t) unsigned char storage[inlineSize];
+    void (*invoke)(void* storage) = nullptr;
+    void (*relocate)(void* from, void* to) = nullptr;
+    void (*destroy)(void* storage) = nullptr;
+};
+
+template<typename Function, typename>
+JobFunction::JobFunction(Function&& function) {
+    using Callable = std::decay_t<Function>;
+    
+    if constexpr (sizeof(Callable) <= inlineSize && alignof(Callable) <= alignof(std::max_align_t)) {
+        new (storage) Callable(std::forward<Function>(function));
+        invoke = [](void* storage) { (*static_cast<Callable*>(storage))(); };
+        relocate = [](void* from, void* to) {
+            new (to) Callable(std::move(*static_cast<Callable*>(from)));
+            static_cast<Callable*>(from)->~Callable();
+        };
+        destroy = [](void* storage) { static_cast<Callable*>(storage)->~Callable(); };
+    }
+    else {
+        *reinterpret_cast<Callable**>(storage) = new Callable(std::forward<Function>(function));
+        invoke = [](void* storage) { (**static_cast<Callable**>(storage))(); };
+        relocate = [](void* from, void* to) { *static_cast<Callable**>(to) = *static_cast<Callable**>(from); };
+        destroy = [](void* storage) { delete *static_cast<Callable**>(storage); };
+    }
+}
+
+JobFunction::JobFunction(JobFunction&& other) noexcept {
+    *this = std::move(other);
+}
+
+JobFunction& JobFunction::operator=(JobFunction&& other) noexcept {
+    if (this == &other) return *this;
+    
+    if (destroy) destroy(storage);
+    invoke = other.invoke;
+    relocate = other.relocate;
+    destroy = other.destroy;
+    if (relocate) relocate(other.storage, storage);
+    
+    other.invoke = nullptr;
+    other.relocate = nullptr;
+    other.destroy = nullptr;
+    return *this;
+}
+
+JobFunction::~JobFunction() {
+    if (destroy) destroy(storage);
+}
+
+class JobSystem {
+public:
+    ~JobSystem();
+    
+    static void Initialize(unsigned int threadCount = 0);
+    static void Shutdown();
+    
+    void Submit(JobGroup& group, JobFunction job);
+    void Wait(JobGroup& group);
+    unsigned int ThreadCount();
+    int QueuedJobs() const;
+private:
+    struct Job {
+        JobFunction function;
+        JobGroup* group = nullptr;
+    };
+    
+    // Ring of jobs that doubles when full and never shrinks.
+    struct Queue {
+        std::mutex mutex;
+        std::vector<Job> ring;
+        size_t head = 0, count = 0;
+        
+        Queue() : ring(64) {}
+        
+        void PushBack(Job&& job);
+        bool PopBack(Job& job);
+        bool PopFront(Job& job);
+    };
+    
+    bool TryRun(int self);
+    void WorkerLoop(int index);
+    
+    std::vector<std::unique_ptr<Queue>> queues;
+    std::vector<std::thread> workers;
+    std::atomic<int> queued{0};
+    std::atomic<unsigned int> nextQueue{0};
+    bool running = false;
+    
+    std::mutex sleepMutex;
+    std::condition_variable wake;
+};
+
+JobSystem jobSystem;
+
+JobSystem::~JobSystem() {
+    Shutdown();
+}
+
+void JobSystem::Initialize(unsigned int threadCount) {
+    Shutdown();
+    
+    if (threadCount == 0) threadCount = std::thread::hardware_concurrency();
+    if (threadCount == 0) threadCount = 4;
+    
+    jobSystem.running = true;
+    for (unsigned int i = 0; i < threadCount; i++) {
+        jobSystem.queues.push_back(std::make_unique<Queue>());
+    }
+    for (unsigned int i = 1; i < threadCount; i++) {
+        jobSystem.workers.emplace_back(&JobSystem::WorkerLoop, &jobSystem, (int)i);
+    }
+}
+
+void JobSystem::Shutdown() {
+    {
+        std::lock_guard<std::mutex> lock(jobSystem.sleepMutex);
+        jobSystem.running = false;
+    }
+    jobSystem.wake.notify_all();
+    
+    for (std::thread& worker : jobSystem.workers) {
+        worker.join();
+    }
+    jobSystem.workers.clear();
+    jobSystem.queues.clear();
+}
+
+unsigned int JobSystem::ThreadCount() {
+    return queues.empty() ? 1 : (unsigned int)queues.size();
+}
+
+// Jobs submitted but not yet started, across every queue; only a hint, since
+// other threads submit and take jobs meanwhile.
+int JobSystem::QueuedJobs() const {
+    return queued.load(std::memory_order_relaxed);
+}
+
+void JobSystem::Queue::PushBack(Job&& job) {
+    if (count == ring.size()) {
+        std::vector<Job> grown(ring.size() * 2);
+        for (size_t i = 0; i < count; i++) grown[i] = std::move(ring[(head + i) % ring.size()]);
+        ring.swap(grown);
+        head = 0;
+    }
+    ring[(head + count) % ring.size()] = std::move(job);
+    count++;
+}
+
+bool JobSystem::Queue::PopBack(Job& job) {
+    if (count == 0) return false;
+    
+    count--;
+    job = std::move(ring[(head + count) % ring.size()]);
+    return true;
+}
+
+bool JobSystem::Queue::PopFront(Job& job) {
+    if (count == 0) return false;
+    
+    job = std::move(ring[head]);
+    head = (head + 1) % ring.size();
+    count--;
+    return true;
+}
+
+void JobSystem::Submit(JobGroup& group, JobFunction job) {
+    if (queues.empty()) {
+        job();
+        return;
+    }
+    
+    group.pending++;
+    
+    int index = jobWorkerIndex >= 0 ? jobWorkerIndex : (int)(nextQueue++ % queues.size());
+    {
+        std::lock_guard<std::mutex> lock(queues[index]->mutex);
+        queues[index]->PushBack({std::move(job), &group});
+    }
+    queued++;
+    
+    {
+        std::lock_guard<std::mutex> lock(sleepMutex);
+    }
+    wake.notify_one();
+}
+
+bool JobSystem::TryRun(int self) {
+    Job job;
+    bool found = false;
+    
+    if (self >= 0) {
+        std::lock_guard<std::mutex> lock(queues[self]->mutex);
+        found = queues[self]->PopBack(job);
+    }
+    
+    int count = (int)queues.size();
+    int start = self >= 0 ? self + 1 : (int)(nextQueue % count);
+    
+    for (int i = 0; i < count && !found; i++) {
+        int victim = (start + i) % count;
+        if (victim == self) continue;
+        
+        std::lock_guard<std::mutex> lock(queues[victim]->mutex);
+        found = queues[victim]->PopFront(job);
+    }
+    
+    if (!found) return false;
+    
+    queued--;
+    job.function();
+    job.group->pending--;
+    return true;
+}
+
+void JobSystem::Wait(JobGroup& group) {
+    while (group.pending > 0) {
+        if (!TryRun(jobWorkerIndex)) std::this_thread::yield();
+    }
+}
+
+void JobSystem::WorkerLoop(int index) {
+    jobWorkerIndex = index;
+    
+    while (true) {
+        if (TryRun(index)) continue;
+        
+        std::unique_lock<std::mutex> lock(sleepMutex);
+        wake.wait(lock, [this]() { return queued > 0 || !running; });
+        if (!running) break;
+    }
+    jobWorkerIndex = -1;
+}
+
+#endif /* jobSystem_h */
@@ -103,4 +103,20 @@ double noiseLayer(double x, double y, double lacunarity, double persistance, int
     return n;
 }
 
+// Upper bound on |noise()|: sqrt(3)/2 for unit gradients, times sqrt(2) for the
+// cube-edge gradients above, rounded up.
+const double noiseBound = 1.25;
+
+// How far octaves [first, octaves) of noiseLayer() can still move its result.
+double noiseLayerRemaining(double persistance, int first, int octaves) {
+    double ampl = 2.0;
+    double maxAmplitude = 0.0;
+    
+    for (int i = 0; i < octaves; i++) {
+        if (i >= first) maxAmplitude += ampl;
+        ampl *= persistance;
+    }
+    return maxAmplitude * noiseBound;
+}
+
 #endif /* noise_h */
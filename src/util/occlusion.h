@@ -0,0 +1,330 @@
+//
+//  occlusion.h
+//  Marching Cube Terrain
+//
+//  Created by Dmitri Wamback on 2026-10-16.
+//
+
+#ifndef occlusion_h
+#define occlusion_h
+
+// Chunks whose bounding box lies entirely behind nearer terrain are skipped
+// (see ChunkManager::Render): near chunks' occluder boxes are rasterized into
+// a small CPU depth buffer, reduced into a hierarchical-Z pyramid, and each
+// remaining chunk's box is tested against it before drawing.
+bool occlusionCulling = true;
+
+// Lattice points [low, high] of a chunk that are all solid, so every cube
+// between them is inside the terrain at the level of detail it was meshed at
+// (see Terrain::BuildOccluders).
+struct OccluderBox {
+    uint8_t low[3], high[3];
+};
+
+// Depth is kept as 1 / w (0 where nothing was drawn), so nearer is larger.
+// Occluders are rasterized at pixel centres only and are always inside
+// terrain, so a pixel's depth is never nearer than what the window draws
+// there. Each pyramid level holds the farthest (smallest) depth of the 2x2
+// texels below it. The rasterizer and the reduction use SSE4.1 when the CPU
+// has it (simd); results are the same either way.
+class OcclusionBuffer {
+public:
+    static const int width = 256, height = 128;
+    static const int levels = 8;
+    
+    bool simd = NOISE_SIMD_X86 && noiseIsa != NoiseIsa::Scalar;
+    int triangles = 0;
+    
+    OcclusionBuffer();
+    
+    void Begin(const glm::mat4& viewProjection, glm::vec3 eye);
+    void AddBox(glm::vec3 min, glm::vec3 max);
+    void AddTriangle(glm::vec3 a, glm::vec3 b, glm::vec3 c);
+    void BuildPyramid();
+    bool Occluded(const AABB& box) const;
+    
+    float Depth(int x, int y) const {
+        return pyramid[0][y * width + x];
+    }
+private:
+    // Closest w a vertex is rasterized at; geometry nearer than this is clipped.
+    static constexpr float nearW = 0.05f;
+    
+    void AddPolygon(const glm::vec4* points, int count);
+    void Rasterize(glm::vec3 a, glm::vec3 b, glm::vec3 c);
+    void RasterizeRows(const float edges[9], const float plane[3], int x0, int x1, int y0, int y1);
+    
+    glm::mat4 viewProjection;
+    glm::vec3 eye;
+    std::array<std::vector<float>, levels> pyramid;
+};
+
+OcclusionBuffer::OcclusionBuffer() {
+    for (int level = 0; level < levels; level++) {
+        pyramid[level].assign((width >> level) * (height >> level), 0.0f);
+    }
+}
+
+void OcclusionBuffer::Begin(const glm::mat4& viewProjection, glm::vec3 eye) {
+    this->viewProjection = viewProjection;
+    this->eye = eye;
+    triangles = 0;
+    std::fill(pyramid[0].begin(), pyramid[0].end(), 0.0f);
+}
+
+// Only the faces turned towards the eye are drawn; a box around the eye draws nothing.
+void OcclusionBuffer::AddBox(glm::vec3 min, glm::vec3 max) {
+    glm::vec4 corners[8];
+    for (int i = 0; i < 8; i++) {
+        glm::vec3 corner = glm::vec3(i & 1 ? max.x : min.x, i & 2 ? max.y : min.y, i & 4 ? max.z : min.z);
+        corners[i] = viewProjection * glm::vec4(corner, 1.0f);
+    }
+    
+    // Corner indices of the face on each side of each axis.
+    static const int faces[3][2][4] = {
+        {{0, 2, 6, 4}, {1, 3, 7, 5}},
+        {{0, 1, 5, 4}, {2, 3, 7, 6}},
+        {{0, 1, 3, 2}, {4, 5, 7, 6}}
+    };
+    
+    for (int axis = 0; axis < 3; axis++) {
+        int side = eye[axis] < min[axis] ? 0 : eye[axis] > max[axis] ? 1 : -1;
+        if (side < 0) continue;
+        
+        glm::vec4 face[4];
+        for (int i = 0; i < 4; i++) face[i] = corners[faces[axis][side][i]];
+        AddPolygon(face, 4);
+    }
+}
+
+void OcclusionBuffer::AddTriangle(glm::vec3 a, glm::vec3 b, glm::vec3 c) {
+    glm::vec4 points[3] = {
+        viewProjection * glm::vec4(a, 1.0f),
+        viewProjection * glm::vec4(b, 1.0f),
+        viewProjection * glm::vec4(c, 1.0f)
+    };
+    AddPolygon(points, 3);
+}
+
+// Clips against the near distance and the four sides of the screen, so
+// screen coordinates stay small, then draws the result as a fan.
+void OcclusionBuffer::AddPolygon(const glm::vec4* points, int count) {
+    glm::vec4 buffers[2][12];
+    glm::vec4* in = buffers[0];
+    glm::vec4* out = buffers[1];
+    std::copy(points, points + count, in);
+    
+    auto distance = [](const glm::vec4& p, int plane) {
+        switch (plane) {
+            case 0:  return p.w - nearW;
+            case 1:  return p.w - p.x;
+            case 2:  return p.w + p.x;
+            case 3:  return p.w - p.y;
+            default: return p.w + p.y;
+        }
+    };
+    
+    for (int plane = 0; plane < 5 && count >= 3; plane++) {
+        int kept = 0;
+        for (int i = 0; i < count; i++) {
+            const glm::vec4& a = in[i];
+            const glm::vec4& b = in[(i + 1) % count];
+            float da = distance(a, plane), db = distance(b, plane);
+            
+            if (da >= 0.0f) out[kept++] = a;
+            if ((da >= 0.0f) != (db >= 0.0f)) out[kept++] = a + (b - a) * (da / (da - db));
+        }
+        count = kept;
+        std::swap(in, out);
+    }
+    if (count < 3) return;
+    
+    glm::vec3 screen[12];
+    for (int i = 0; i < count; i++) {
+        float inverseW = 1.0f / in[i].w;
+        screen[i] = glm::vec3((in[i].x * inverseW * 0.5f + 0.5f) * width, (in[i].y * inverseW * 0.5f + 0.5f) * height, inverseW);
+    }
+    for (int i = 1; i + 1 < count; i++) Rasterize(screen[0], screen[i], screen[i + 1]);
+}
+
+// Screen-space triangle with 1 / w in z, either winding.
+void OcclusionBuffer::Rasterize(glm::vec3 a, glm::vec3 b, glm::vec3 c) {
+    float area = (b.x - a.x) * (c.y - a.y) - (b.y - a.y) * (c.x - a.x);
+    if (fabs(area) < 1e-6f) return;
+    if (area < 0.0f) {
+        std::swap(b, c);
+        area = -area;
+    }
+    triangles++;
+    
+    int x0 = std::max((int)ceilf(std::min({a.x, b.x, c.x}) - 0.5f), 0);
+    int x1 = std::min((int)floorf(std::max({a.x, b.x, c.x}) - 0.5f), width - 1);
+    int y0 = std::max((int)ceilf(std::min({a.y, b.y, c.y}) - 0.5f), 0);
+    int y1 = std::min((int)floorf(std::max({a.y, b.y, c.y}) - 0.5f), height - 1);
+    if (x0 > x1 || y0 > y1) return;
+    
+    // Edge i is non-negative on the inside of the edge opposite vertex i:
+    // edges[3i] * x + edges[3i + 1] * y + edges[3i + 2].
+    const glm::vec3* vertices[3] = {&a, &b, &c};
+    float edges[9];
+    for (int i = 0; i < 3; i++) {
+        const glm::vec3& from = *vertices[(i + 1) % 3];
+        const glm::vec3& to = *vertices[(i + 2) % 3];
+        edges[i * 3] = from.y - to.y;
+        edges[i * 3 + 1] = to.x - from.x;
+        edges[i * 3 + 2] = from.x * to.y - from.y * to.x;
+    }
+    
+    // 1 / w is linear in screen space: plane[0] * x + plane[1] * y + plane[2].
+    float plane[3];
+    plane[0] = ((b.z - a.z) * (c.y - a.y) - (c.z - a.z) * (b.y - a.y)) / area;
+    plane[1] = ((c.z - a.z) * (b.x - a.x) - (b.z - a.z) * (c.x - a.x)) / area;
+    plane[2] = a.z - plane[0] * a.x - plane[1] * a.y;
+    
+    RasterizeRows(edges, plane, x0, x1, y0, y1);
+}
+
+#if NOISE_SIMD_X86
+
+NOISE_TARGET_SSE41
+static void rasterizeRowsSSE41(float* depth, int width, const float edges[9], const float plane[3], int x0, int x1, int y0, int y1) {
+    const __m128 zero = _mm_setzero_ps();
+    const __m128 lanes = _mm_setr_ps(0.0f, 1.0f, 2.0f, 3.0f);
+    const __m128i first = _mm_set1_epi32(x0), last = _mm_set1_epi32(x1);
+    
+    for (int y = y0; y <= y1; y++) {
+        float center = (float)y + 0.5f;
+        __m128 rowEdge0 = _mm_set1_ps(edges[1] * center + edges[2]);
+        __m128 rowEdge1 = _mm_set1_ps(edges[4] * center + edges[5]);
+        __m128 rowEdge2 = _mm_set1_ps(edges[7] * center + edges[8]);
+        __m128 rowDepth = _mm_set1_ps(plane[1] * center + plane[2]);
+        float* row = depth + y * width;
+        
+        for (int x = x0 & ~3; x <= x1; x += 4) {
+            __m128 px = _mm_add_ps(_mm_set1_ps((float)x + 0.5f), lanes);
+            __m128i index = _mm_add_epi32(_mm_set1_epi32(x), _mm_setr_epi32(0, 1, 2, 3));
+            __m128 inRange = _mm_castsi128_ps(_mm_andnot_si128(_mm_or_si128(_mm_cmplt_epi32(index, first), _mm_cmpgt_epi32(index, last)),
+                                                               _mm_set1_epi32(-1)));
+            
+            __m128 e0 = _mm_add_ps(_mm_mul_ps(_mm_set1_ps(edges[0]), px), rowEdge0);
+            __m128 e1 = _mm_add_ps(_mm_mul_ps(_mm_set1_ps(edges[3]), px), rowEdge1);
+            __m128 e2 = _mm_add_ps(_mm_mul_ps(_mm_set1_ps(edges[6]), px), rowEdge2);
+            __m128 inside = _mm_and_ps(_mm_and_ps(_mm_cmpge_ps(e0, zero), _mm_cmpge_ps(e1, zero)),
+                                       _mm_and_ps(_mm_cmpge_ps(e2, zero), inRange));
+            if (_mm_movemask_ps(inside) == 0) continue;
+            
+            __m128 z = _mm_add_ps(_mm_mul_ps(_mm_set1_ps(plane[0]), px), rowDepth);
+            __m128 old = _mm_loadu_ps(row + x);
+            _mm_storeu_ps(row + x, _mm_blendv_ps(old, _mm_max_ps(old, z), inside));
+        }
+    }
+}
+
+NOISE_TARGET_SSE41
+static void reduceLevelSSE41(const float* source, float* target, int targetWidth, int targetHeight) {
+    int sourceWidth = targetWidth * 2;
+    for (int y = 0; y < targetHeight; y++) {
+        const float* top = source + y * 2 * sourceWidth;
+        const float* bottom = top + sourceWidth;
+        
+        for (int x = 0; x < targetWidth; x += 4) {
+            __m128 low = _mm_min_ps(_mm_loadu_ps(top + x * 2), _mm_loadu_ps(bottom + x * 2));
+            __m128 high = _mm_min_ps(_mm_loadu_ps(top + x * 2 + 4), _mm_loadu_ps(bottom + x * 2 + 4));
+            __m128 even = _mm_shuffle_ps(low, high, _MM_SHUFFLE(2, 0, 2, 0));
+            __m128 odd = _mm_shuffle_ps(low, high, _MM_SHUFFLE(3, 1, 3, 1));
+            _mm_storeu_ps(target + y * targetWidth + x, _mm_min_ps(even, odd));
+        }
+    }
+}
+
+#endif
+
+void OcclusionBuffer::RasterizeRows(const float edges[9], const float plane[3], int x0, int x1, int y0, int y1) {
+    float* depth = pyramid[0].data();
+
+#if NOISE_SIMD_X86
+    if (simd) {
+        rasterizeRowsSSE41(depth, width, edges, plane, x0, x1, y0, y1);
+        return;
+    }
+#endif
+    
+    for (int y = y0; y <= y1; y++) {
+        float center = (float)y + 0.5f;
+        float rowEdge0 = edges[1] * center + edges[2];
+        float rowEdge1 = edges[4] * center + edges[5];
+        float rowEdge2 = edges[7] * center + edges[8];
+        float rowDepth = plane[1] * center + plane[2];
+        float* row = depth + y * width;
+        
+        for (int x = x0; x <= x1; x++) {
+            float px = (float)x + 0.5f;
+            if (edges[0] * px + rowEdge0 < 0.0f || edges[3] * px + rowEdge1 < 0.0f || edges[6] * px + rowEdge2 < 0.0f) continue;
+            
+            row[x] = std::max(row[x], plane[0] * px + rowDepth);
+        }
+    }
+}
+
+void OcclusionBuffer::BuildPyramid() {
+    for (int level = 1; level < levels; level++) {
+        const std::vector<float>& source = pyramid[level - 1];
+        std::vector<float>& target = pyramid[level];
+        int targetWidth = width >> level, targetHeight = height >> level;
+
+#if NOISE_SIMD_X86
+        if (simd && targetWidth % 4 == 0) {
+            reduceLevelSSE41(source.data(), target.data(), targetWidth, targetHeight);
+            continue;
+        }
+#endif
+        
+        for (int y = 0; y < targetHeight; y++) {
+            for (int x = 0; x < targetWidth; x++) {
+                const float* top = &source[(y * 2) * (targetWidth * 2) + x * 2];
+                const float* bottom = top + targetWidth * 2;
+                target[y * targetWidth + x] = std::min(std::min(top[0], top[1]), std::min(bottom[0], bottom[1]));
+            }
+        }
+    }
+}
+
+// Tests the box's nearest depth against the farthest occluder over the
+// pixels it covers on screen, read from the level where those span at most
+// 2x2 texels. A box crossing the near distance counts as visible.
+bool OcclusionBuffer::Occluded(const AABB& box) const {
+    if (box.Empty()) return false;
+    
+    float minX = INFINITY, maxX = -INFINITY, minY = INFINITY, maxY = -INFINITY, nearest = 0.0f;
+    for (int i = 0; i < 8; i++) {
+        glm::vec3 corner = glm::vec3(i & 1 ? box.max.x : box.min.x, i & 2 ? box.max.y : box.min.y, i & 4 ? box.max.z : box.min.z);
+        glm::vec4 clip = viewProjection * glm::vec4(corner, 1.0f);
+        if (clip.w < nearW) return false;
+        
+        float inverseW = 1.0f / clip.w;
+        float x = (clip.x * inverseW * 0.5f + 0.5f) * width;
+        float y = (clip.y * inverseW * 0.5f + 0.5f) * height;
+        minX = std::min(minX, x);
+        maxX = std::max(maxX, x);
+        minY = std::min(minY, y);
+        maxY = std::max(maxY, y);
+        nearest = std::max(nearest, inverseW);
+    }
+    if (maxX < 0.0f || maxY < 0.0f || minX >= width || minY >= height) return false;
+    
+    int x0 = std::max((int)minX, 0), x1 = std::min((int)maxX, width - 1);
+    int y0 = std::max((int)minY, 0), y1 = std::min((int)maxY, height - 1);
+    int level = 0;
+    while (level < levels - 1 && ((x1 >> level) - (x0 >> level) > 1 || (y1 >> level) - (y0 >> level) > 1)) level++;
+    
+    const std::vector<float>& texels = pyramid[level];
+    int levelWidth = width >> level;
+    for (int y = y0 >> level; y <= y1 >> level; y++) {
+        for (int x = x0 >> level; x <= x1 >> level; x++) {
+            if (nearest >= texels[y * levelWidth + x]) return false;
+        }
+    }
+    return true;
+}
+
+#endif /* occlusion_h */
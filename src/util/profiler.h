@@ -0,0 +1,211 @@
+//
+//  profiler.h
+//  Marching Cube Terrain
+//
+//  Created by Dmitri Wamback on 2026-10-16.
+//
+
+#ifndef profiler_h
+#define profiler_h
+
+// Scoped timers and counters for the hot paths. Each thread records into its
+// own buffer, so a scope costs two clock reads and a push_back; Write turns the
+// buffers into a Chrome/Perfetto trace (chrome://tracing, ui.perfetto.dev) and
+// prints per-scope percentiles and counter totals.
+//
+// On by default in debug builds and gone entirely under NDEBUG: the macros
+// expand to nothing and none of this is compiled. -DTERRAIN_PROFILE=1 or 0
+// overrides either way.
+
+#ifndef TERRAIN_PROFILE
+#ifdef NDEBUG
+#define TERRAIN_PROFILE 0
+#else
+#define TERRAIN_PROFILE 1
+#endif
+#endif
+
+#if TERRAIN_PROFILE
+
+#include <mutex>
+#include <atomic>
+#include <climits>
+#include <cstdio>
+#include <map>
+#include <memory>
+#include <algorithm>
+
+enum class ProfileCounter {
+    Triangles,
+    Vertices,
+    BytesUploaded,
+    Count
+};
+
+const char* profileCounterNames[] = {"triangles", "vertices", "bytes uploaded"};
+
+struct ProfileEvent {
+    const char* name;
+    int64_t start, duration;
+    int chunkX, chunkZ;
+    uint64_t counters[(int)ProfileCounter::Count];
+};
+
+class Profiler {
+public:
+    Profiler();
+    
+    int64_t Now() const;
+    void Record(const char* name, int64_t start, int chunkX, int chunkZ);
+    void Count(ProfileCounter counter, uint64_t value);
+    void Frame();
+    bool Write(const std::string& path);
+private:
+    struct ThreadEvents {
+        int thread;
+        std::vector<ProfileEvent> events;
+    };
+    
+    static constexpr size_t eventsPerThread = 1 << 20;
+    
+    ThreadEvents& Local();
+    
+    std::chrono::steady_clock::time_point epoch;
+    std::mutex mutex;
+    std::vector<std::unique_ptr<ThreadEvents>> threads;
+    std::atomic<uint64_t> counters[(int)ProfileCounter::Count] = {};
+    uint64_t frameCounters[(int)ProfileCounter::Count] = {};
+    int64_t frameStart = -1;
+    std::atomic<uint64_t> dropped{0};
+};
+
+Profiler profiler;
+
+class ProfileScope {
+public:
+    ProfileScope(const char* name, int chunkX = INT_MIN, int chunkZ = INT_MIN) : name(name), chunkX(chunkX), chunkZ(chunkZ), start(profiler.Now()) {}
+    ~ProfileScope() { profiler.Record(name, start, chunkX, chunkZ); }
+private:
+    const char* name;
+    int chunkX, chunkZ;
+    int64_t start;
+};
+
+Profiler::Profiler() : epoch(std::chrono::steady_clock::now()) {}
+
+int64_t Profiler::Now() const {
+    return std::chrono::duration_cast<std::chrono::nanoseconds>(std::chrono::steady_clock::now() - epoch).count();
+}
+
+Profiler::ThreadEvents& Profiler::Local() {
+    thread_local ThreadEvents* local = nullptr;
+    if (!local) {
+        std::lock_guard<std::mutex> lock(mutex);
+        threads.push_back(std::make_unique<ThreadEvents>());
+        local = threads.back().get();
+        local->thread = (int)threads.size();
+        local->events.reserve(4096);
+    }
+    return *local;
+}
+
+void Profiler::Record(const char* name, int64_t start, int chunkX, int chunkZ) {
+    int64_t end = Now();
+    ThreadEvents& local = Local();
+    
+    if (local.events.size() >= eventsPerThread) {
+        dropped++;
+        return;
+    }
+    local.events.push_back({name, start, end - start, chunkX, chunkZ, {}});
+}
+
+void Profiler::Count(ProfileCounter counter, uint64_t value) {
+    counters[(int)counter].fetch_add(value, std::memory_order_relaxed);
+}
+
+// Closes a frame: one "frame" event carrying what the counters gained during it.
+void Profiler::Frame() {
+    int64_t now = Now();
+    if (frameStart >= 0) {
+        ThreadEvents& local = Local();
+        ProfileEvent event = {"frame", frameStart, now - frameStart, INT_MIN, INT_MIN, {}};
+        
+        for (int i = 0; i < (int)ProfileCounter::Count; i++) {
+            uint64_t total = counters[i].load(std::memory_order_relaxed);
+            event.counters[i] = total - frameCounters[i];
+            frameCounters[i] = total;
+        }
+        if (local.events.size() < eventsPerThread) local.events.push_back(event);
+    }
+    frameStart = now;
+}
+
+// Call once the worker threads are idle; their buffers are read without locks.
+bool Profiler::Write(const std::string& path) {
+    std::ofstream file(path);
+    if (!file) return false;
+    
+    std::map<std::string, std::vector<int64_t>> durations;
+    bool first = true;
+    
+    file << "{\"displayTimeUnit\":\"ms\",\"traceEvents\":[\n";
+    for (const auto& thread : threads) {
+        for (const ProfileEvent& event : thread->events) {
+            durations[event.name].push_back(event.duration);
+                
+            file << (first ? "" : ",\n") << "{\"name\":\"" << event.name << "\",\"ph\":\"X\",\"pid\":1,\"tid\":" << thread->thread
+                 << ",\"ts\":" << event.start / 1000.0 << ",\"dur\":" << event.duration / 1000.0;
+            if (event.chunkX != INT_MIN) file << ",\"args\":{\"x\":" << event.chunkX << ",\"z\":" << event.chunkZ << "}";
+            file << "}";
+            first = false;
+                
+            if (!strcmp(event.name, "frame")) {
+                file << ",\n{\"name\":\"frame counters\",\"ph\":\"C\",\"pid\":1,\"ts\":" << event.start / 1000.0 << ",\"args\":{";
+                for (int i = 0; i < (int)ProfileCounter::Count; i++) {
+                    file << (i ? "," : "") << "\"" << profileCounterNames[i] << "\":" << event.counters[i];
+                }
+                file << "}}";
+            }
+        }
+    }
+    file << "\n]}\n";
+    
+    std::cout << "trace " << path << (dropped ? " (" + std::to_string(dropped) + " events dropped)" : "") << '\n';
+    std::cout << "scope              count    total ms     p50 us     p95 us     p99 us     max us\n";
+    for (auto& [name, times] : durations) {
+        std::sort(times.begin(), times.end());
+        auto percentile = [&](double p) { return times[std::min(times.size() - 1, (size_t)(p * times.size()))] / 1000.0; };
+        
+        int64_t total = 0;
+        for (int64_t time : times) total += time;
+        
+        std::printf("%-16s %8zu %11.2f %10.1f %10.1f %10.1f %10.1f\n", name.c_str(), times.size(), total / 1e6,
+                    percentile(0.5), percentile(0.95), percentile(0.99), times.back() / 1000.0);
+    }
+    for (int i = 0; i < (int)ProfileCounter::Count; i++) {
+        std::cout << profileCounterNames[i] << " " << counters[i].load() << '\n';
+    }
+    return true;
+}
+
+#define PROFILE_CONCAT_INNER(a, b) a##b
+#define PROFILE_CONCAT(a, b) PROFILE_CONCAT_INNER(a, b)
+
+#define PROFILE_SCOPE(name) ProfileScope PROFILE_CONCAT(profileScope, __LINE__)(name)
+#define PROFILE_CHUNK(name, x, z) ProfileScope PROFILE_CONCAT(profileScope, __LINE__)(name, x, z)
+#define PROFILE_COUNT(counter, value) profiler.Count(ProfileCounter::counter, value)
+#define PROFILE_FRAME() profiler.Frame()
+#define PROFILE_WRITE(path) profiler.Write(path)
+
+#else
+
+#define PROFILE_SCOPE(name)
+#define PROFILE_CHUNK(name, x, z)
+#define PROFILE_COUNT(counter, value)
+#define PROFILE_FRAME()
+#define PROFILE_WRITE(path)
+
+#endif
+
+#endif /* profiler_h */
@@ -0,0 +1,102 @@
+//
+//  rangeAllocator.h
+//  Marching Cube Terrain
+//
+//  Created by Dmitri Wamback on 2026-10-16.
+//
+
+#ifndef rangeAllocator_h
+#define rangeAllocator_h
+
+#include <map>
+
+// First-fit allocator over [0, size) in abstract units (vertices, indices).
+// Free ranges are kept by offset and merged with their neighbours on Free.
+// It only does the bookkeeping; the caller owns whatever storage it indexes.
+class RangeAllocator {
+public:
+    RangeAllocator(uint32_t size = 0);
+    
+    bool Allocate(uint32_t count, uint32_t& offset);
+    void Free(uint32_t offset, uint32_t count);
+    void Grow(uint32_t newSize);
+    void Reset();
+    
+    uint32_t Size() const { return size; }
+    uint32_t Used() const { return used; }
+    uint32_t LargestFree() const;
+    size_t FreeRanges() const { return freeRanges.size(); }
+private:
+    uint32_t size = 0, used = 0;
+    std::map<uint32_t, uint32_t> freeRanges;
+};
+
+RangeAllocator::RangeAllocator(uint32_t size) : size(size) {
+    if (size) freeRanges[0] = size;
+}
+
+bool RangeAllocator::Allocate(uint32_t count, uint32_t& offset) {
+    if (count == 0) {
+        offset = 0;
+        return true;
+    }
+    
+    for (auto it = freeRanges.begin(); it != freeRanges.end(); it++) {
+        if (it->second < count) continue;
+        
+        offset = it->first;
+        uint32_t remaining = it->second - count;
+        freeRanges.erase(it);
+        if (remaining) freeRanges[offset + count] = remaining;
+        
+        used += count;
+        return true;
+    }
+    return false;
+}
+
+void RangeAllocator::Free(uint32_t offset, uint32_t count) {
+    if (count == 0) return;
+    used -= count;
+    
+    auto next = freeRanges.lower_bound(offset);
+    if (next != freeRanges.end() && offset + count == next->first) {
+        count += next->second;
+        next = freeRanges.erase(next);
+    }
+    
+    if (next != freeRanges.begin()) {
+        auto previous = std::prev(next);
+        if (previous->first + previous->second == offset) {
+            previous->second += count;
+            return;
+        }
+    }
+    freeRanges[offset] = count;
+}
+
+// Appends [size, newSize) as free space, merged into a trailing free range.
+void RangeAllocator::Grow(uint32_t newSize) {
+    if (newSize <= size) return;
+    
+    uint32_t added = newSize - size;
+    uint32_t offset = size;
+    size = newSize;
+    
+    used += added;
+    Free(offset, added);
+}
+
+uint32_t RangeAllocator::LargestFree() const {
+    uint32_t largest = 0;
+    for (auto& [offset, count] : freeRanges) largest = std::max(largest, count);
+    return largest;
+}
+
+void RangeAllocator::Reset() {
+    freeRanges.clear();
+    used = 0;
+    if (size) freeRanges[0] = size;
+}
+
+#endif /* rangeAllocator_h */
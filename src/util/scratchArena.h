@@ -0,0 +1,82 @@
+//
+//  scratchArena.h
+//  Marching Cube Terrain
+//
+//  Created by Dmitri Wamback on 2026-10-16.
+//
+
+#ifndef scratchArena_h
+#define scratchArena_h
+
+#include <memory>
+#include <atomic>
+
+// Working buffers for sampling, meshing and packing a chunk. Every thread
+// keeps its own and they only ever grow, so once a worker has built a few
+// chunks it builds the rest without touching the heap.
+struct ScratchArena {
+    std::vector<float> columns;
+    std::vector<glm::ivec3> rows;
+    std::vector<uint32_t> edgeCache;
+    std::vector<Vertex> vertices;
+    std::vector<uint16_t> packedDensity;
+    std::vector<std::vector<Vertex>> slabVertices;
+    std::vector<std::vector<uint32_t>> slabIndices;
+    std::vector<std::vector<uint32_t>> slabPlanes;
+    
+    // Largest size each buffer whose size varies by chunk has needed in any arena.
+    inline static std::atomic<size_t> largestVertices{0}, largestPackedDensity{0};
+    inline static std::atomic<size_t> largestSlabVertices{0}, largestSlabIndices{0};
+};
+
+// Makes room for size elements. A buffer that has to grow grows to the
+// largest size it has needed in any arena, rounded up to a power of two, so
+// every thread's arenas settle soon after the largest chunk has been seen
+// once rather than each growing at its own new largest chunk.
+template<typename T>
+void reserveScratch(std::vector<T>& buffer, size_t size, std::atomic<size_t>& largest) {
+    size_t seen = largest.load(std::memory_order_relaxed);
+    while (size > seen && !largest.compare_exchange_weak(seen, size, std::memory_order_relaxed)) {}
+    
+    size = std::max(size, seen);
+    if (buffer.capacity() < size) buffer.reserve(std::bit_ceil(size));
+}
+
+// A thread's arena for the lifetime of the lease. A thread waiting on a
+// JobGroup can run another chunk's job while the first chunk still holds its
+// arena, so a lease taken inside another gets the thread's next arena.
+class ScratchLease {
+public:
+    ScratchLease();
+    ~ScratchLease();
+    
+    ScratchLease(const ScratchLease&) = delete;
+    ScratchLease& operator=(const ScratchLease&) = delete;
+    
+    ScratchArena* operator->() const { return arena; }
+    ScratchArena& operator*() const { return *arena; }
+private:
+    struct ThreadArenas {
+        std::vector<std::unique_ptr<ScratchArena>> arenas;
+        size_t depth = 0;
+    };
+    
+    static ThreadArenas& Local() {
+        thread_local ThreadArenas local;
+        return local;
+    }
+    
+    ScratchArena* arena;
+};
+
+ScratchLease::ScratchLease() {
+    ThreadArenas& local = Local();
+    if (local.depth == local.arenas.size()) local.arenas.push_back(std::make_unique<ScratchArena>());
+    arena = local.arenas[local.depth++].get();
+}
+
+ScratchLease::~ScratchLease() {
+    Local().depth--;
+}
+
+#endif /* scratchArena_h */